@@ -0,0 +1,75 @@
+/**
+ * Header       RotaryCommonModeFilter.h
+ *
+ * Purpose      Rejection of common mode glitches (e.g. EMI spikes of relays) which hit
+ *              the lines of several encoders at once. Works on a port snapshot with
+ *              the CLK and DT lines of all encoders: if at least threshold of these
+ *              lines changed since the previous snapshot, the changed lines keep their
+ *              last passed levels for this snapshot.
+ *
+ * Constructor
+ * arguments    mask       bits of the port holding encoder lines
+ *              threshold  number of simultaneously changed lines considered improbable,
+ *                         at least 2 (a single encoder changes 1 line per sample)
+ *
+ * Remarks      A spike does not last, a real change does: a line with the same level
+ *              in two snapshots always passes. So lines that really changed together
+ *              with a spike or with the return from one are delayed by one sample, two
+ *              if the spike hit the changing line itself. With spikes at least 3
+ *              samples apart every state lasting 3 samples passes and is decoded.
+ *              RotaryEncoderMatrix filters each row with it (enableCommonModeFilter()),
+ *              directly wired encoders read from one port register can use it alike:
+ *                 uint32_t port = filter.filter(REG_READ(GPIO_IN_REG));
+ *                 encoder0.feed((port >> PIN_CLK0) & 1, (port >> PIN_DT0) & 1, ...);
+ */
+#ifndef _ROTARYCOMMONMODEFILTER_H_
+#define _ROTARYCOMMONMODEFILTER_H_
+#include <stdint.h>
+
+class RotaryCommonModeFilter
+{
+  public:
+    RotaryCommonModeFilter(uint32_t mask = 0, uint8_t threshold = 3) :
+      _mask(mask),
+      _threshold(threshold < 2 ? 2 : threshold)
+    {}
+
+    void begin(uint32_t port) { _passed = _prev = port & _mask; }  // Levels of the first snapshot
+
+    uint32_t filter(uint32_t port)
+    {
+      uint32_t levels  = port & _mask;
+      uint32_t changed = levels ^ _prev;
+      _prev = levels;
+      if (_atLeast(changed, _threshold))                           // Simultaneous change: glitch
+      {
+        uint32_t passed = (levels & ~changed) | (_passed & changed);   // Changed lines keep passed levels
+        if (passed != levels) _rejections++;
+        _passed = passed;
+        return (port & ~_mask) | passed;
+      }
+      _passed = levels;
+      return port;
+    }
+
+    uint32_t getRejections() const { return _rejections; }        // Snapshots with masked lines
+    void setThreshold(uint8_t threshold) { _threshold = threshold < 2 ? 2 : threshold; }
+
+  private:
+    static bool _atLeast(uint32_t bits, uint8_t count)  // At least count bits set, stops early
+    {
+      for (uint8_t i = 0; i < count; i++)
+      {
+        if (bits == 0) return false;
+        bits &= bits - 1;                                          // Clear lowest set bit
+      }
+      return true;
+    }
+
+    uint32_t _mask;
+    uint8_t _threshold;
+    uint32_t _passed = 0;                                          // Levels passed on last
+    uint32_t _prev = 0;                                            // Levels of the previous snapshot
+    uint32_t _rejections = 0;
+};
+#endif
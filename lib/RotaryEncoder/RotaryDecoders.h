@@ -0,0 +1,70 @@
+/**
+ * Header       RotaryDecoders.h
+ *
+ * Purpose      The two debouncing decoders of the rotary motion, shared by the
+ *              RotaryEncoder class, the decoder stages of RotaryPipeline.h and the
+ *              ULP program (RotaryEncoderUlp.h). See RotaryEncoder.cpp for the methods.
+ *
+ *                 int8_t decode(uint8_t ab)   CLK DT as bits 1 0 -> +1 CW, -1 CCW, 0 no full step
+ *                 bool atDetent() const       last sample CLK and DT high
+ *                 void setDetent()            continue from the detent, no step in progress
+ *
+ * Remarks      Header only and without virtual functions, so decode() is inlined
+ *              into the loop of the class as well as into a composed pipeline.
+ */
+#ifndef _ROTARYDECODERS_H_
+#define _ROTARYDECODERS_H_
+#include <stdint.h>
+
+const uint16_t ROTARY_VALID_TRANSITIONS = 0x6996;  // Valid transition table as bit mask, bit i = transition i
+
+/**
+ * Debouncing by table lookup of valid transitions
+ */
+struct TableDecoder
+{
+  void begin() {}
+  int8_t decode(uint8_t ab)
+  {
+    _newTransition = ((_newTransition << 2) | ab) & 0b1111;  // index into the valid transition table
+    if ((ROTARY_VALID_TRANSITIONS >> _newTransition) & 1)
+    {
+      _transitions = (_transitions << 4) | _newTransition;   // last two valid transitions
+      if (_transitions == 0b00010111) return  1;             // full step CW (T3T4)
+      if (_transitions == 0b00101011) return -1;             // full step CCW (t3t4)
+    }
+    return 0;
+  }
+  bool valid() const { return (ROTARY_VALID_TRANSITIONS >> _newTransition) & 1; }  // Last sample made a valid transition
+  bool atDetent() const { return (_newTransition & 0b11) == 0b11; }
+  void setDetent() { _newTransition = 0b1111; _transitions = 0; }
+  uint8_t _newTransition = 0;
+  uint8_t _transitions = 0;
+};
+
+/**
+ * Debouncing by cleaning of clock and data signal
+ */
+struct CleaningDecoder
+{
+  void begin() {}
+  int8_t decode(uint8_t ab)
+  {
+    uint8_t changed = ab ^ _prev;                 // transitions, even bouncing
+    _prev = ab;
+    if (changed & 0b10) _cleaned = (_cleaned & 0b01) | ((ab & 0b01) << 1);  // clean CLK = DT
+    if (changed & 0b01) _cleaned = (_cleaned & 0b10) | ((ab & 0b10) >> 1);  // clean DT = CLK
+    uint8_t rising = _cleaned & ~_prevCleaned;
+    int8_t step = 0;
+    if ((rising & 0b10) && ! (_cleaned & 0b01)) step =  1;
+    if ((rising & 0b01) && ! (_cleaned & 0b10)) step = -1;
+    _prevCleaned = _cleaned;
+    return step;
+  }
+  bool atDetent() const { return _prev == 0b11; }
+  void setDetent() { _prev = _cleaned = _prevCleaned = 0b11; }
+  uint8_t _prev = 0b11;
+  uint8_t _cleaned = 0b11;
+  uint8_t _prevCleaned = 0b11;
+};
+#endif
@@ -14,6 +14,86 @@
  *              debouncing methods.  
  * 
  * Remarks      No interrupts are used. Call RotaryEncoder::loop() inside your main loop()
+ *              or feed() samples taken elsewhere with their timestamp. The decoding 
+ *              methods only work on the sampled levels and the time of the loop() pass,
+ *              so they run unchanged on a host (see RotaryEncoderHal.h). Both are
+ *              implemented once in RotaryDecoders.h, the decoder stages of RotaryPipeline.h.
+ *              feed() counts the milliseconds of the button timing from the differences
+ *              of the timestamps, so these may wrap like micros(); consecutive ones must
+ *              be less than half the range apart (35 minutes with 32 bit).
+ * 
+ * Chord mode   With setChordMode() steps made while the axial pushbutton is held
+ *              are routed to onPressedCW() / onPressedCCW() instead of onCW() / onCCW(),
+ *              e.g. for coarse adjustment. The release ending such a chord does
+ *              not produce a click or long click. The button state sampled by
+ *              _debounceButton() in the same loop() pass is used, no extra pin reads.
+ * 
+ * Events       With enableEventBuffer() every action is additionally stored with the 
+ *              micros() timestamp of the loop() pass in a ring buffer of EVENT_BUFFER_SIZE
+ *              entries, to be fetched with popEvent(). When the buffer is full, new
+ *              events are dropped and counted in getEventOverflows().
+ *              A batch callback (addOnEventsCB()) instead gets the events of each pass
+ *              at its end as a span of the buffer itself, no copies. The buffer is then
+ *              emptied and restarts at index 0, so the next span is contiguous again.
+ * 
+ * Prediction   To compensate the latency of a display, predictPosition() extrapolates
+ *              the position to a future time with an alpha-beta filter over the step times
+ *              (fixed point, position Q8 = 1/256 steps, velocity Q24 steps/us):
+ *                 xp = x + v * dt              prediction at the time of the new step
+ *                 r  = measured - xp           residual
+ *                 x  = xp + r / 2              alpha = 1/2
+ *                 v  = v + r / 8 / dt          beta  = 1/8
+ *              The velocity is initialized from the first step interval of a motion.
+ *              The extrapolation is clamped between the last measured step and just 
+ *              below the next one, so it never shows a step which has not happened.
+ *              When no step follows within 2 expected step intervals (stop) or the
+ *              direction reverses, the measured position is returned.
+ * 
+ * Auto         With enableAutoDebounce() the debounce time of the pushbutton follows
+ * debounce     the bouncing actually measured. Edges closer than the current debounce
+ *              time form a burst, its duration (first to last edge) is one sample.
+ *              The 95th percentile of the samples is tracked by stochastic approximation:
+ *                 sample > q:  q += 19 * (q / 256 + 1)
+ *                 sample <= q: q -= q / 256 + 1
+ *              so q moves by at most a few percent per burst. The debounce time is set
+ *              to 1.5 * q + 1 ms, limited to [msMin, msMax].
+ *              The debounce time does not delay any event, presses shorter than it are
+ *              ignored as bouncing. So tuning changes the minimum press length, not the
+ *              click latency.
+ * 
+ * Sampling     The rotary pins and the pushbutton are sampled at separate intervals
+ * intervals    (setSamplingIntervals()), by default the rotary pins in every pass and
+ *              the button at most every 1000 us. Each channel has a fixed grid of
+ *              slots, anchor + k * interval: a pass samples the channel when it is in
+ *              a later slot than the last sample. The anchor moves by whole intervals,
+ *              so the sampling instants do not depend on how often loop() is called.
+ * 
+ * Reconfig-    The debouncing method and timings form a RotaryEncoderConfig which is
+ * uration      published with publishConfig() into the free slot of a double buffer,
+ *              even while loop() runs in an ISR or on another core:
+ *                 seq[slot]++ (odd) -> write slot -> seq[slot]++ (even) -> version = slot
+ *              At the start of each pass the decoder checks the version (one atomic
+ *              load). A new config is copied and discarded if seq changed meanwhile,
+ *              it is then retried in the next pass. Neither side ever waits or locks.
+ *              A change of the debouncing method is only taken over at a detent 
+ *              (CLK and DT high), where no step is in progress. Both decoders are then
+ *              set to the detent state, so no step is lost or added by the switch.
+ *              publishConfig() must not be called from several tasks concurrently.
+ * 
+ * Quadrature   With enableQuadratureAnalysis() the table decoder measures the time
+ * analysis     spent in each of the 4 states of every full step (only valid transitions):
+ *                 CW   11 -> 10 -> 00 -> 01 -> 11      CCW  11 -> 01 -> 00 -> 10 -> 11
+ *              As fractions f of the step period T in Q8 (ideal 64 each):
+ *                 duty CLK    = f11 + f10            ideal 128 (50 %)
+ *                 duty DT     = f11 + f01            ideal 128
+ *                 phase error = (f10 + f01) / 2 - 64 (lag of the 2nd channel at both
+ *                                                     edges minus a quarter period)
+ *              running averages over about 16 steps. A step is flagged asymmetric 
+ *              when its shortest state lasts less than 2 sampling intervals (given, or
+ *              measured as running average over 8 samples from the first ones), such a
+ *              state may be missed at the current poll rate. Only steps of continuous
+ *              rotation are analyzed (time in the detent 11 not longer than the other
+ *              3 states together), at rest the detent state would dominate.
  * 
  * Debouncing   Debouncing by cleaning of clock and data signal
  * method 1      
@@ -69,53 +149,315 @@
 /**
  * Debounce rotary encoder by cleaning clock and data signal
  */
-void RotaryEncoder::_debounceRotaryByCleaning()
+void RotaryEncoder::_debounceRotaryByCleaning(uint8_t clk, uint8_t data)
 {
-  _clkState  = digitalRead(_pinClk);
-  _dataState = digitalRead(_pinData);
+  int8_t step = _cleaning.decode((clk ? 0b10 : 0) | (data ? 0b01 : 0));
+  if (step > 0) _stepCW();
+  if (step < 0) _stepCCW();
+} 
 
-  if (_prevClkState != _clkState)     // clock transition detected (even bouncing)
+/**
+ * Debounce rotary encoder by table lookup and handle
+ *    onCW()
+ *    onCCW()
+ */
+void RotaryEncoder::_debounceRotaryByTable(uint8_t clk, uint8_t data)
+{
+  int8_t step = _table.decode((clk ? 0b10 : 0) | (data ? 0b01 : 0));
+
+  if (_quadAnalysis)
   {
-    _prevClkState = _clkState;
-    _cleanedClkState = _dataState;    // copy data state to get clean clock
-    digitalWrite(GPIO_NUM_2, _cleanedClkState);
+    if (_measureSampleInterval)              // running average of the sampling interval
+    {
+      unsigned long dt = _usNow - _usLastRotarySample;
+      if (! _rotarySampled) _rotarySampled = true;                  // first sample, no interval yet
+      else if (_usSampleIntervalSum == 0) _usSampleIntervalSum = 8 * dt;  // first interval seeds the average
+      else _usSampleIntervalSum += dt - _usSampleIntervalSum / 8;
+      _usSampleInterval = _usSampleIntervalSum / 8;
+      _usLastRotarySample = _usNow;
+    }
+    if (step) _analyzeStep(step);            // before the time of state 11 is overwritten
+    if (_table.valid())
+    {
+      _usStateEntered[_table._newTransition & 0b11] = _usNow;
+      _statesEntered |= 1 << (_table._newTransition & 0b11);
+    }
   }
+  if (step > 0) _stepCW();                   // full step in clockwise direction done (T3T4)
+  if (step < 0) _stepCCW();                  // full step in counterclockwise direction done (t3t4)
+}
 
-  if (_prevDataState != _dataState)   // data transition detected (even bouncing)
+/**
+ * Analyze the quadrature states of the full step just completed (state 11 entered now)
+ */
+void RotaryEncoder::_analyzeStep(int8_t dir)
+{
+  if (_statesEntered != 0b1111) return;      // not all states seen since enabled
+
+  const unsigned long *t = _usStateEntered;  // index = CLK DT
+  unsigned long d11, d10, d00, d01;
+  if (dir > 0)                               // 11 -> 10 -> 00 -> 01 -> 11
   {
-    _prevDataState = _dataState;
-    _cleanedDataState = _clkState;    // copy clock state to get clean data
-    digitalWrite(GPIO_NUM_4, _cleanedDataState);
+    d11 = t[0b10] - t[0b11];
+    d10 = t[0b00] - t[0b10];
+    d00 = t[0b01] - t[0b00];
+    d01 = _usNow  - t[0b01];
   }
-  bool risingClk  = _prevCleanedClkState  == LOW  && _cleanedClkState == HIGH;
-  bool risingData = _prevCleanedDataState == LOW  && _cleanedDataState == HIGH;
+  else                                       // 11 -> 01 -> 00 -> 10 -> 11
+  {
+    d11 = t[0b01] - t[0b11];
+    d01 = t[0b00] - t[0b01];
+    d00 = t[0b10] - t[0b00];
+    d10 = _usNow  - t[0b10];
+  }
+  unsigned long period = _usNow - t[0b11];
+  if (period == 0) return;
+  if (d11 > period || d10 > period || d00 > period || d01 > period) return;  // states out of order (wrapped)
+  if (d11 > d10 + d00 + d01) return;                            // from rest, no continuous rotation
 
-  if (risingClk  && _cleanedDataState == LOW) {_onCW();  /* Serial.printf("%s\n", "debounced by cleaning"); */}
-  if (risingData && _cleanedClkState  == LOW) {_onCCW(); /* Serial.printf("%s\n", "debounced by cleaning"); */}
+  long f11 = (long)(((uint64_t)d11 * 256 + period / 2) / period);   // rounded
+  long f10 = (long)(((uint64_t)d10 * 256 + period / 2) / period);
+  long f01 = (long)(((uint64_t)d01 * 256 + period / 2) / period);
+  long dutyClk  = f11 + f10;
+  long dutyData = f11 + f01;
+  long phaseError = (f10 + f01) / 2 - 64;
 
-  _prevCleanedClkState  = _cleanedClkState;
-  _prevCleanedDataState = _cleanedDataState;
-} 
+  _quadSum[0] += dutyClk    - _quadSum[0] / 16;   // sums of 16 averages
+  _quadSum[1] += dutyData   - _quadSum[1] / 16;
+  _quadSum[2] += phaseError - _quadSum[2] / 16;
+  _quad.dutyClk    = (_quadSum[0] + 8) / 16;
+  _quad.dutyData   = (_quadSum[1] + 8) / 16;
+  _quad.phaseError = _quadSum[2] / 16;
+  unsigned long absError = phaseError < 0 ? -phaseError : phaseError;
+  if (absError > _quad.maxPhaseError) _quad.maxPhaseError = absError;
+
+  unsigned long dMin = d11;
+  if (d10 < dMin) dMin = d10;
+  if (d00 < dMin) dMin = d00;
+  if (d01 < dMin) dMin = d01;
+  _quad.minState = (uint16_t)((uint64_t)dMin * 256 / period);
+  if (dMin < 2 * _usSampleInterval) _quad.asymmetricSteps++;
+  _quad.steps++;
+}
 
 /**
- * Debounce rotary encoder by table lookup and handle
- *    onCW()
- *    onCCW()
+ * Enable the analysis of the quadrature signal quality (table decoder only).
+ * usSampleInterval is the interval the rotary pins are sampled at, 0 measures it.
+ */
+void RotaryEncoder::enableQuadratureAnalysis(bool enable, unsigned long usSampleInterval)
+{
+  _quadAnalysis = enable;
+  _quad = QuadratureStats();
+  _quadSum[0] = _quadSum[1] = 128 * 16;
+  _quadSum[2] = 0;
+  _statesEntered = 0;
+  _measureSampleInterval = usSampleInterval == 0;
+  _usSampleInterval = usSampleInterval;
+  _usSampleIntervalSum = 0;
+  _rotarySampled = false;
+}
+
+/**
+ * Get and set the state of the table decoder
+ */
+void RotaryEncoder::getTableState(uint8_t &newTransition, uint16_t &transitions) const
+{
+  newTransition = _table._newTransition;
+  transitions = _table._transitions;
+}
+
+void RotaryEncoder::setTableState(uint8_t newTransition, uint16_t transitions)
+{
+  _table._newTransition = newTransition & 0b1111;
+  _table._transitions = (uint8_t)transitions;
+}
+
+/**
+ * Dispatch steps which were counted outside of loop(), 
+ * e.g. by the ULP coprocessor while the main cores were sleeping.
+ * A batch callback gets the events whenever the buffer is full and at the end.
+ */
+void RotaryEncoder::replaySteps(int16_t steps)
+{
+  _usNow = micros();
+  for (; steps != 0; steps += steps > 0 ? -1 : 1)
+  {
+    if (steps > 0) _stepCW();
+    else _stepCCW();
+    if (_onEvents && (uint8_t)(_eventHead - _eventTail) >= EVENT_BUFFER_SIZE) _dispatchEvents();
+  }
+  if (_onEvents && _eventHead != _eventTail) _dispatchEvents();
+}
+
+/**
+ * Dispatch a step in clockwise or counterclockwise direction,
+ * in chord mode to the pressed callbacks while the button is held
+ */
+void RotaryEncoder::_stepCW()
+{
+  if (_chordMode && _buttonState == LOW)
+  {
+    _chordUsed = true;
+    _pushEvent(ROTARY_PRESSED_CW);
+    _onPressedCW();
+  }
+  else
+  {
+    _pushEvent(ROTARY_CW);
+    _onCW();
+  }
+  _position++;
+  _updatePrediction(1);
+}
+
+void RotaryEncoder::_stepCCW()
+{
+  if (_chordMode && _buttonState == LOW)
+  {
+    _chordUsed = true;
+    _pushEvent(ROTARY_PRESSED_CCW);
+    _onPressedCCW();
+  }
+  else
+  {
+    _pushEvent(ROTARY_CCW);
+    _onCCW();
+  }
+  _position--;
+  _updatePrediction(-1);
+}
+
+/**
+ * Update the alpha-beta filter with the step just made in direction dir
+ */
+void RotaryEncoder::_updatePrediction(int8_t dir)
+{
+  if (! _predictionEnabled) return;
+
+  long measured = _position * 256;
+  unsigned long dt = _usNow - _usLastStep;
+  _usLastStep = _usNow;
+
+  if (_predSteps == 0 || dir != _lastDir || dt > _usPredictTimeout || dt == 0)  // Start of a new motion
+  {
+    _predX = measured;
+    _predV = 0;
+    _predSteps = 1;
+    _lastDir = dir;
+    return;
+  }
+
+  if (_predSteps == 1)                   // 2nd step, initialize velocity from the interval
+  {
+    _predX = measured;
+    _predV = dir * (long)((1UL << 24) / dt);
+  }
+  else
+  {
+    long xp = _predX + (long)(((int64_t)_predV * (int64_t)dt) >> 16);
+    long r  = measured - xp;
+    _predX = xp + r / 2;
+    _predV += (long)(((int64_t)r * 65536 / 8) / (int64_t)dt);
+  }
+  if (_predSteps < 255) _predSteps++;
+}
+
+/**
+ * Enable the position prediction. usTimeout is the longest step interval 
+ * still considered as continuous motion.
+ */
+void RotaryEncoder::enablePrediction(bool enable, unsigned long usTimeout)
+{
+  _predictionEnabled = enable;
+  _usPredictTimeout = usTimeout;
+  _predSteps = 0;
+}
+
+/**
+ * Predict the position at time usTarget (micros()) in 1/256 steps
+ */
+long RotaryEncoder::predictPosition(unsigned long usTarget) const
+{
+  long measured = _position * 256;
+  if (! _predictionEnabled || _predSteps < 2 || _predV == 0) return measured;
+
+  long dt = (long)(usTarget - _usLastStep);
+  if (dt <= 0) return measured;
+  int64_t speed = _predV < 0 ? -(int64_t)_predV : _predV;
+  if ((unsigned long)dt > _usPredictTimeout || speed * dt > (2LL << 24)) return measured;  // Stopped
+
+  long xp = _predX + (long)(((int64_t)_predV * dt) >> 16);
+  if (_lastDir > 0) 
+    return xp < measured ? measured : (xp > measured + 255 ? measured + 255 : xp);
+  else
+    return xp > measured ? measured : (xp < measured - 255 ? measured - 255 : xp);
+}
+
+/**
+ * Store an action in the event buffer, if enabled
+ */
+void RotaryEncoder::_pushEvent(uint8_t type)
+{
+  if (! _eventBufferEnabled) return;
+  if ((uint8_t)(_eventHead - _eventTail) >= EVENT_BUFFER_SIZE)  // Buffer full, drop newest
+  {
+    _eventOverflows++;
+    return;
+  }
+  RotaryEvent &event = _events[_eventHead & (EVENT_BUFFER_SIZE - 1)];
+  event.us   = _usNow;
+  event.type = type;
+  _eventHead++;
+}
+
+/**
+ * Pass the buffered events to the batch callback and empty the buffer. The span 
+ * wraps only if events were pending when the callback was added, then it takes 2 calls.
+ */
+void RotaryEncoder::_dispatchEvents()
+{
+  uint8_t first = _eventTail & (EVENT_BUFFER_SIZE - 1);
+  uint8_t count = _eventHead - _eventTail;
+  uint8_t span  = count < EVENT_BUFFER_SIZE - first ? count : EVENT_BUFFER_SIZE - first;
+  _onEvents(&_events[first], span);
+  if (span < count) _onEvents(_events, count - span);
+  _eventHead = _eventTail = 0;
+}
+
+/**
+ * Enable or disable recording of the actions in the event buffer.
+ * The buffer is emptied in either case.
  */
-void RotaryEncoder::_debounceRotaryByTable()
+void RotaryEncoder::enableEventBuffer(bool enable)
 {
-  _newTransition <<= 2; // shift previous transition 2 bits to the left
-  if (digitalRead(_pinClk))   _newTransition |= 0b0010;  // compose newTransition 
-  if (digitalRead(_pinData))  _newTransition |= 0b0001;  // from clock and data
-  _newTransition &= 0b1111;  // clear high byte, newTransition is now the index into the valid transistion table
+  _eventBufferEnabled = enable;
+  _eventHead = _eventTail = 0;
+  _eventOverflows = 0;
+}
+
+uint8_t RotaryEncoder::availableEvents() const
+{
+  return _eventHead - _eventTail;
+}
+
+/**
+ * Get the oldest event without removing it from the buffer
+ */
+bool RotaryEncoder::peekEvent(RotaryEvent &event) const
+{
+  if (_eventHead == _eventTail) return false;
+  event = _events[_eventTail & (EVENT_BUFFER_SIZE - 1)];
+  return true;
+}
 
-   if (_validTransitions[_newTransition] ) 
-   {
-      _transitions <<= 4;  // shift old indices to the left
-      _transitions |= _newTransition;   // add new transition
-      if ((_transitions & 0xff) == 0b00010111) {_onCW();  /* Serial.printf("%s\n", "debounced by table"); */}  // full step in clockwise direction done (T3T4) 
-      if ((_transitions & 0xff) == 0b00101011) {_onCCW(); /* Serial.printf("%s\n", "debounced by table"); */}  // full step in counterclockwise direction done (t3t4)
-   }
+/**
+ * Get and remove the oldest event from the buffer
+ */
+bool RotaryEncoder::popEvent(RotaryEvent &event)
+{
+  if (! peekEvent(event)) return false;
+  _eventTail++;
+  return true;
 }
 
 /**
@@ -125,7 +467,82 @@ void RotaryEncoder::_debounceRotaryByTable()
  */
 void RotaryEncoder::setDebouncingRotEncByTable(bool byTable)
 {
-  _debouncingRotEncByTable = byTable;
+  RotaryEncoderConfig config = getPublishedConfig();
+  config.debouncingByTable = byTable;
+  publishConfig(config);
+}
+
+/**
+ * Publish a new configuration, the decoder takes it over at the next safe point
+ */
+void RotaryEncoder::publishConfig(const RotaryEncoderConfig &config)
+{
+  uint32_t version = _configVersion.load(std::memory_order_relaxed) + 1;
+  uint8_t slot = version & 1;
+  _configSeq[slot].fetch_add(1, std::memory_order_relaxed);    // odd, slot being written
+  std::atomic_thread_fence(std::memory_order_release);
+  _configs[slot] = config;
+  _configSeq[slot].fetch_add(1, std::memory_order_release);    // even, slot complete
+  _configVersion.store(version, std::memory_order_release);
+}
+
+/**
+ * Get the last published configuration, to be called by the publishing task
+ */
+RotaryEncoderConfig RotaryEncoder::getPublishedConfig() const
+{
+  uint32_t version = _configVersion.load(std::memory_order_acquire);
+  return version == 0 ? _config : _configs[version & 1];
+}
+
+/**
+ * Take over a newly published configuration, called at the start of each pass
+ */
+void RotaryEncoder::_adoptConfig()
+{
+  uint32_t version = _configVersion.load(std::memory_order_acquire);
+  if (version == _adoptedVersion) return;
+
+  uint8_t slot = version & 1;
+  uint32_t seq = _configSeq[slot].load(std::memory_order_acquire);
+  if (seq & 1) return;                                          // being written, retry next pass
+  RotaryEncoderConfig config = _configs[slot];
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (_configSeq[slot].load(std::memory_order_relaxed) != seq) return;  // overwritten meanwhile
+
+  if (config.debouncingByTable != _config.debouncingByTable)
+  {
+    if (! _atDetent()) return;                                  // step in progress, retry next pass
+    _table.setDetent();                                         // both decoders at the detent
+    _cleaning.setDetent();
+  }
+  if (config.autoDebounce && ! _config.autoDebounce)            // Tuning starts from the current debounce time
+  {
+    _usBounceQuantile = _msDebounce * 1000 * 2 / 3;
+    _burstOpen = false;
+  }
+  if (! config.autoDebounce && config.msDebounce != _config.msDebounce) _msDebounce = config.msDebounce;
+  _config = config;
+  _adoptedVersion = version;
+}
+
+/**
+ * True if the last sample of the active decoder shows CLK and DT high
+ */
+bool RotaryEncoder::_atDetent() const
+{
+  return _config.debouncingByTable ? _table.atDetent() : _cleaning.atDetent();
+}
+
+/**
+ * Set chord mode
+ * true  = steps made while the button is held call onPressedCW() / onPressedCCW()
+ * false = steps always call onCW() / onCCW() (this is the default)
+ */
+void RotaryEncoder::setChordMode(bool chord)
+{
+  _chordMode = chord;
+  _chordUsed = false;
 }
 
 /**
@@ -134,57 +551,206 @@ void RotaryEncoder::setDebouncingRotEncByTable(bool byTable)
  *    onLongClick()
  *    onDoubleClick()
  */
-void RotaryEncoder::_debounceButton()
+void RotaryEncoder::_debounceButton(uint8_t button)
 {
   _prevButtonState = _buttonState;
-  _buttonState = digitalRead(_pinButton);
+  _buttonState = button;
+
+  if (_config.autoDebounce && _prevButtonState != _buttonState) _measureBounce();
 
   // Debouncing pushbutton
   if (_prevButtonState == HIGH && _buttonState == LOW) // Axial pushbutton pressed
   {
-    _msButtonDown = millis();                          // Memorize time
+    _msButtonDown = _msNow;                          // Memorize time
+    if (_msChordRelease != 0 && _msNow - _msChordRelease < _msDebounce)
+      _chordUsed = true;                               // Release of chord bounced, still in chord
   }
   else if (_prevButtonState == LOW && _buttonState == HIGH) // Pushbutton released
   {
-    if (millis() - _msButtonDown < _msDebounce)        // Pushutton bounces
+    _msChordRelease = 0;
+    if (_chordUsed)                                    // Rotated while pressed, no click
+    {
+      _chordUsed = false;
+      _msChordRelease = _msNow;
+    }
+    else if (_msNow - _msButtonDown < _msDebounce)   // Pushutton bounces
     {
       // Ignore bouncing
     }
-    else if (millis() - _msButtonDown > _msLongClick)  // Its a long click
+    else if (_msNow - _msButtonDown > _config.msLongClick)  // Its a long click
     {
+      _pushEvent(ROTARY_LONG_CLICK);
       _onLongClick();
     }
     else
     {
       _clickCount++;                  
       if (_clickCount == 1)           // Time of 1st click, just memorize
-        _msFirstClick = millis();
+        _msFirstClick = _msNow;
     }
   }
   else       // This branch only passed through when nothing is to do in loop 
   {
-    if (_clickCount == 1 && millis() - _msFirstClick > _msDoubleClickGap) // Time after 1st click expired
+    if (_clickCount == 1 && _msNow - _msFirstClick > _config.msDoubleClickGap) // Time after 1st click expired
       {
         _msFirstClick = 0;
         _clickCount = 0;
+        _pushEvent(ROTARY_CLICK);
         _onClick();
       }
     else if (_clickCount > 1)         // More than 1 click done 
     {
       _msFirstClick = 0;
       _clickCount = 0;
+      _pushEvent(ROTARY_DOUBLE_CLICK);
       _onDoubleClick(); 
     } 
   }
 }
 
+/**
+ * Measure the duration of bounce bursts at the button edges and adapt the debounce time
+ */
+void RotaryEncoder::_measureBounce()
+{
+  if (_burstOpen && _usNow - _usLastEdge < _msDebounce * 1000)  // Burst continues
+  {
+    _usLastEdge = _usNow;
+    return;
+  }
+
+  if (_burstOpen)                                               // Previous burst finished
+  {
+    unsigned long sample = _usLastEdge - _usBurstStart;
+    unsigned long step = _usBounceQuantile / 256 + 1;
+    if (sample > _usBounceQuantile)
+      _usBounceQuantile += 19 * step;
+    else
+      _usBounceQuantile = _usBounceQuantile > step ? _usBounceQuantile - step : 0;
+
+    unsigned long ms = (_usBounceQuantile * 3 / 2 + 1000 + 999) / 1000;
+    _msDebounce = ms < _config.msDebounceMin ? _config.msDebounceMin : (ms > _config.msDebounceMax ? _config.msDebounceMax : ms);
+  }
+  _burstOpen = true;
+  _usBurstStart = _usLastEdge = _usNow;
+}
+
+/**
+ * Enable tuning of the button debounce time to the measured bouncing, published
+ * with the configuration like publishConfig(). The tuning starts from the debounce
+ * time in use when the decoder takes it over; switched off, the tuned time stays
+ * until a different msDebounce is published.
+ */
+void RotaryEncoder::enableAutoDebounce(bool enable, unsigned long msMin, unsigned long msMax)
+{
+  RotaryEncoderConfig config = getPublishedConfig();
+  config.autoDebounce = enable;
+  config.msDebounceMin = msMin;
+  config.msDebounceMax = msMax < msMin ? msMin : msMax;
+  publishConfig(config);
+}
+
 /**
  * Call this method in your main loop
  */
 void RotaryEncoder::loop()
 {
-  _debounceButton(); 
-  _debouncingRotEncByTable ? _debounceRotaryByTable() : _debounceRotaryByCleaning(); 
+  _usNow = micros();
+  _msNow = millis();
+  _adoptConfig();
+  if (_due(_usButtonAnchor, _config.usButtonInterval)) _debounceButton(digitalRead(_pinButton)); 
+  if (_due(_usRotaryAnchor, _config.usRotaryInterval))
+    _config.debouncingByTable ? _debounceRotaryByTable(digitalRead(_pinClk), digitalRead(_pinData)) 
+                             : _debounceRotaryByCleaning(digitalRead(_pinClk), digitalRead(_pinData)); 
+  if (_onEvents && _eventHead != _eventTail) _dispatchEvents();
+}
+
+/**
+ * Instead of loop(), feed samples taken elsewhere together with their time, 
+ * e.g. edge events with kernel timestamps on a Linux host
+ */
+void RotaryEncoder::feed(uint8_t clk, uint8_t data, uint8_t button, unsigned long usTimestamp)
+{
+  _usNow = usTimestamp;
+  _advanceMillis();
+  _adoptConfig();
+  if (_due(_usButtonAnchor, _config.usButtonInterval)) _debounceButton(button); 
+  if (_due(_usRotaryAnchor, _config.usRotaryInterval))
+    _config.debouncingByTable ? _debounceRotaryByTable(clk, data) : _debounceRotaryByCleaning(clk, data); 
+  if (_onEvents && _eventHead != _eventTail) _dispatchEvents();
+}
+
+/**
+ * Advance the milliseconds of fed timestamps by the whole ms elapsed since the
+ * start of the current ms, so they wrap together with the microseconds
+ * (usTimestamp / 1000 would jump back at the wrap of a 32 bit unsigned long)
+ */
+void RotaryEncoder::_advanceMillis()
+{
+  if (! _fed)
+  {
+    _fed = true;
+    _msNow = _usNow / 1000;
+    _usMsStart = _usNow - _usNow % 1000;
+    return;
+  }
+  long elapsed = (long)(_usNow - _usMsStart);    // < 0: timestamp slightly back, ms unchanged
+  if (elapsed < 1000) return;
+  _msNow += elapsed / 1000;
+  _usMsStart += elapsed - elapsed % 1000;
+}
+
+/**
+ * Check whether a channel is to be sampled in this pass and advance its slot
+ */
+bool RotaryEncoder::_due(unsigned long &usAnchor, unsigned long usInterval)
+{
+  if (usInterval == 0) return true;
+  unsigned long elapsed = _usNow - usAnchor;
+  if (elapsed < usInterval) return false;
+  usAnchor += elapsed - elapsed % usInterval;
+  return true;
+}
+
+/**
+ * Get the start of the slots the channels were last sampled in, the next sample
+ * of a channel is taken in the first pass at least one interval later
+ */
+void RotaryEncoder::getSamplingAnchors(unsigned long &usRotary, unsigned long &usButton) const
+{
+  usRotary = _usRotaryAnchor;
+  usButton = _usButtonAnchor;
+}
+
+/**
+ * Get the time from which the next button sample reports a pending click or
+ * double click, false if none is pending. Used to skip idle time in simulations,
+ * in the time base of feed().
+ */
+bool RotaryEncoder::getClickDeadline(unsigned long &usDeadline) const
+{
+  if (_clickCount == 1) 
+  {
+    long msLeft = (long)(_msFirstClick + _config.msDoubleClickGap + 1 - _msNow);
+    usDeadline = msLeft > 0 ? _usMsStart + msLeft * 1000 : _usNow + 1;
+  }
+  else if (_clickCount > 1)
+    usDeadline = _usNow + 1;
+  else
+    return false;
+  return true;
+}
+
+/**
+ * Set the sampling intervals of the rotary pins and the pushbutton in microseconds.
+ * 0 samples the channel in every loop() pass.
+ */
+void RotaryEncoder::setSamplingIntervals(unsigned long usRotary, unsigned long usButton)
+{
+  RotaryEncoderConfig config = getPublishedConfig();
+  config.usRotaryInterval = usRotary;
+  config.usButtonInterval = usButton;
+  publishConfig(config);
 }
 
 // Methods to add the callbacks
@@ -214,3 +780,21 @@ void RotaryEncoder::addOnCounterClockwiseCB(CallbackFunction cb)
 {
   _onCCW = cb;
 };
+
+// 2 callbacks for rotation with pushbutton held (chord mode)
+void RotaryEncoder::addOnPressedClockwiseCB(CallbackFunction cb)
+{
+  _onPressedCW = cb;
+};
+
+void RotaryEncoder::addOnPressedCounterClockwiseCB(CallbackFunction cb)
+{
+  _onPressedCCW = cb;
+};
+
+// Batch callback for all events of a pass, records the events
+void RotaryEncoder::addOnEventsCB(BatchCallbackFunction cb)
+{
+  _onEvents = cb;
+  if (cb && ! _eventBufferEnabled) enableEventBuffer();
+};
@@ -9,6 +9,7 @@
  * arguments    pinClk     input pin clock
  *              pinData    input pin data
  *              pinButton  input pin pushbutton (optional, only for encoders with pushbutton)
+ *              no pins    encoder fed with samples by feed() instead of loop()
  * 
  * Remarks       Add corrresponding callbacks to be called on following actions:
  *               onCW()          Clock wise rotation
@@ -16,18 +17,83 @@
  *               onClick()       Actuating the axial pushbutton
  *               onLongClick()   Long actuation of the axial pushbutton
  *               onDoubleClick() Double actuation of the axial pushbutton
+ *               onPressedCW()   Clock wise rotation with pushbutton held (chord mode)
+ *               onPressedCCW()  Counter clock wise rotation with pushbutton held (chord mode)
+ *               onEvents()      All timestamped actions of a loop() pass at once (batch)
  * 
  *               No interrupts are used. Call RotaryEncoder::loop() inside your main loop()
+ * 
+ *               Optionally all actions are recorded as timestamped events in a small
+ *               buffer (enableEventBuffer()), e.g. to merge the events of several 
+ *               encoders in chronological order with RotaryEventMerger.
+ * 
+ *               getPosition() returns the number of steps (CW positive), 
+ *               predictPosition() extrapolates it to a future time (enablePrediction()).
  */  
 #ifndef _ROTARYENCODER_H_
 #define _ROTARYENCODER_H_
-#include <Arduino.h>
+#include "RotaryEncoderHal.h"
+#include "RotaryDecoders.h"
+#include <atomic>
 
 typedef void (*CallbackFunction)();
 
+// Actions recorded in the event buffer
+enum RotaryEventType : uint8_t 
+{
+  ROTARY_CW,
+  ROTARY_CCW,
+  ROTARY_PRESSED_CW,
+  ROTARY_PRESSED_CCW,
+  ROTARY_CLICK,
+  ROTARY_LONG_CLICK,
+  ROTARY_DOUBLE_CLICK
+};
+
+// Debouncing method and timings, published as a whole by publishConfig()
+struct RotaryEncoderConfig
+{
+  bool debouncingByTable = true;           // false selects debouncing by cleaning clock and data signal
+  unsigned long msDebounce = 50;           // After 50ms the button should have reached a stationary state
+  unsigned long msLongClick = 300;         // Button held longer than 300ms is considered LongClick
+  unsigned long msDoubleClickGap = 250;    // Two button clicks within 250ms count as DoubleClick
+  unsigned long usRotaryInterval = 0;      // Rotary pins are sampled in every pass
+  unsigned long usButtonInterval = 1000;   // Button needs no more than 1 kHz
+  bool autoDebounce = false;               // Tune msDebounce to the measured bouncing, see enableAutoDebounce()
+  unsigned long msDebounceMin = 5;         // Bounds of the tuned debounce time
+  unsigned long msDebounceMax = 50;
+};
+
+// Signal quality of the quadrature steps, fractions of a step period in Q8 (256 = 1 period)
+struct QuadratureStats
+{
+  uint16_t dutyClk = 128;         // CLK high, running average (128 = 50 %)
+  uint16_t dutyData = 128;        // DT high, running average
+  int16_t phaseError = 0;         // Phase between CLK and DT minus a quarter period, running average (64 = 90 deg)
+  uint16_t maxPhaseError = 0;     // Largest |phase error| of a single step
+  uint16_t minState = 64;         // Shortest of the 4 states in the last step
+  uint32_t steps = 0;             // Steps analyzed
+  uint32_t asymmetricSteps = 0;   // Steps with a state shorter than 2 sampling intervals
+};
+
+struct RotaryEvent
+{
+  unsigned long us;   // micros() of the loop() pass which detected the action
+  uint8_t type;       // RotaryEventType
+};
+
+typedef void (*BatchCallbackFunction)(const RotaryEvent *events, uint8_t count);  // Events of a pass, oldest first
+
 class RotaryEncoder
 {
   public:
+    // Encoders without own pins, samples are passed by feed()
+    RotaryEncoder() :
+      _pinClk(NO_PIN),
+      _pinData(NO_PIN),
+      _pinButton(NO_PIN)
+    {}
+
     // Encoders without pushbutton
     RotaryEncoder(uint8_t pinClk, uint8_t pinData) :
       _pinClk(pinClk), 
@@ -49,46 +115,122 @@ class RotaryEncoder
     }
  
     void setDebouncingRotEncByTable(bool byTable = true);  // byTable=false selects debouncing by cleaning clock and data signal
+    void setChordMode(bool chord = true);                  // chord=true routes steps made with button held to the pressed callbacks
+    void enableAutoDebounce(bool enable = true, unsigned long msMin = 5, unsigned long msMax = 50);  // Tune button debounce time to measured bouncing, published like publishConfig()
+    unsigned long getDebounce() const { return _msDebounce; }
+    void setSamplingIntervals(unsigned long usRotary, unsigned long usButton);  // 0 = sample in every loop() pass
+    void publishConfig(const RotaryEncoderConfig &config); // Safe while loop() runs in an ISR or on another core
+    RotaryEncoderConfig getPublishedConfig() const;        // Last published, maybe not yet in use
+    const RotaryEncoderConfig &getConfig() const { return _config; }  // In use by the decoder
+    void getSamplingAnchors(unsigned long &usRotary, unsigned long &usButton) const;  // Start of the last sampled slots
+    bool getClickDeadline(unsigned long &usDeadline) const; // Pending click fires at the first button sample from usDeadline
     void addOnClickCB(CallbackFunction cb);
     void addOnLongClickCB(CallbackFunction cb);
     void addOnDoubleClickCB(CallbackFunction cb);
     void addOnClockwiseCB(CallbackFunction cb);
     void addOnCounterClockwiseCB(CallbackFunction cb);
+    void addOnPressedClockwiseCB(CallbackFunction cb);
+    void addOnPressedCounterClockwiseCB(CallbackFunction cb);
+    void addOnEventsCB(BatchCallbackFunction cb);          // All events at the end of a pass, consumes them
+
+    void enableEventBuffer(bool enable = true);            // Record actions as timestamped events
+    uint8_t availableEvents() const;
+    bool peekEvent(RotaryEvent &event) const;
+    bool popEvent(RotaryEvent &event);
+    uint16_t getEventOverflows() const { return _eventOverflows; }
+
+    void getTableState(uint8_t &newTransition, uint16_t &transitions) const;  // State of the table decoder, e.g. to hand it over 
+    void setTableState(uint8_t newTransition, uint16_t transitions);         // to the ULP coprocessor during deep sleep and back
+    void replaySteps(int16_t steps);                       // Dispatch steps counted elsewhere, >0 clockwise, <0 counterclockwise
+
+    long getPosition() const { return _position; }       // Steps since start, clockwise positive
+    void enableQuadratureAnalysis(bool enable = true, unsigned long usSampleInterval = 0);  // 0 = measure sampling interval
+    const QuadratureStats &getQuadratureStats() const { return _quad; }
+    bool isPressed() const { return _buttonState == LOW; }  // Pushbutton held at the last sample
+    void enablePrediction(bool enable = true, unsigned long usTimeout = 100000);
+    long predictPosition(unsigned long usTarget) const;   // Fractional position in 1/256 steps at time usTarget (micros())
 
     void loop();
+    void feed(uint8_t clk, uint8_t data, uint8_t button, unsigned long usTimestamp);  // Instead of loop()
+
+    static const uint8_t EVENT_BUFFER_SIZE = 16;           // Must be a power of 2
+    static const uint8_t NO_PIN = 0xFF;
    
   private:
     static void _nop(){};
-    void _debounceRotaryByCleaning();
-    void _debounceRotaryByTable();
-    void _debounceButton();
+    void _debounceRotaryByCleaning(uint8_t clk, uint8_t data);
+    void _debounceRotaryByTable(uint8_t clk, uint8_t data);
+    void _debounceButton(uint8_t button);
+    void _stepCW();
+    void _stepCCW();
+    void _pushEvent(uint8_t type);
+    void _dispatchEvents();
+    void _updatePrediction(int8_t dir);
+    void _measureBounce();
+    void _analyzeStep(int8_t dir);
+    bool _due(unsigned long &usAnchor, unsigned long usInterval);
+    void _advanceMillis();
+    void _adoptConfig();
+    bool _atDetent() const;
     CallbackFunction _onClick = _nop;
     CallbackFunction _onLongClick = _nop;
     CallbackFunction _onDoubleClick = _nop;
     CallbackFunction _onCW = _nop;
     CallbackFunction _onCCW = _nop;
-    uint8_t _clkState = HIGH;
-    uint8_t _prevClkState = LOW;
-    uint8_t _cleanedClkState;
-    uint8_t _prevCleanedClkState = HIGH;
+    CallbackFunction _onPressedCW = _nop;
+    CallbackFunction _onPressedCCW = _nop;
+    BatchCallbackFunction _onEvents = nullptr;
     uint8_t _buttonState = HIGH;
     uint8_t _prevButtonState;
-    uint8_t _dataState = HIGH;
-    uint8_t _prevDataState;
-    uint8_t _cleanedDataState;
-    uint8_t _prevCleanedDataState;
     uint8_t _pinClk;
     uint8_t _pinData;
     uint8_t _pinButton;
     uint8_t _clickCount = 0;
-    unsigned long _msDebounce = 50;        // After 50ms the button should have reached a stationary state
-    unsigned long _msLongClick = 300;      // Button held longer than 300ms is considered LongClick
-    unsigned long _msDoubleClickGap = 250; // Two button clicks within 250ms count as DoubleClick
+    RotaryEncoderConfig _config;           // In use by the decoder
+    RotaryEncoderConfig _configs[2];       // Double buffer written by publishConfig()
+    std::atomic<uint32_t> _configSeq[2] = {{0}, {0}};  // Odd while a slot is written
+    std::atomic<uint32_t> _configVersion{0};   // Published version, slot = version & 1
+    uint32_t _adoptedVersion = 0;
+    unsigned long _msDebounce = _config.msDebounce;  // Effective, tuned by enableAutoDebounce()
     unsigned long _msButtonDown;
     unsigned long _msFirstClick = 0;
-    uint8_t _newTransition = 0;
-    uint16_t _transitions = 0;
-    const uint8_t _validTransitions[16] = {0,1,1,0,1,0,0,1,1,0,0,1,0,1,1,0};
-    bool _debouncingRotEncByTable = true;
+    unsigned long _msChordRelease = 0;     // Release time of a chord, a press bouncing shortly after belongs to it
+    TableDecoder _table;                   // Decoders shared with RotaryPipeline.h
+    CleaningDecoder _cleaning;
+    bool _chordMode = false;
+    bool _chordUsed = false;               // Rotated while pressed, suppress click on release
+    unsigned long _usNow = 0;              // micros() of the current loop() pass
+    unsigned long _msNow = 0;              // millis() of the current loop() pass
+    unsigned long _usMsStart = 0;          // Fed time at which _msNow began
+    bool _fed = false;                     // _msNow follows fed timestamps
+    RotaryEvent _events[EVENT_BUFFER_SIZE];
+    uint8_t _eventHead = 0;                // Free running indices, masked on access
+    uint8_t _eventTail = 0;
+    uint16_t _eventOverflows = 0;
+    bool _eventBufferEnabled = false;
+    long _position = 0;
+    long _predX = 0;                       // Filtered position, Q8 (1/256 steps)
+    long _predV = 0;                       // Filtered velocity, Q24 steps per microsecond
+    unsigned long _usLastStep = 0;
+    unsigned long _usPredictTimeout = 100000;  // No step for this long, the encoder is at rest
+    uint8_t _predSteps = 0;                // Steps in the current motion, saturating
+    int8_t _lastDir = 0;
+    bool _predictionEnabled = false;
+    unsigned long _usBounceQuantile = 50000;   // Estimated 95th percentile of bounce durations
+    unsigned long _usBurstStart = 0;       // First edge of the current bounce burst
+    unsigned long _usLastEdge = 0;
+    unsigned long _usRotaryAnchor = 0;     // Start of the current sampling slot
+    unsigned long _usButtonAnchor = 0;
+    bool _burstOpen = false;
+    QuadratureStats _quad;
+    long _quadSum[3];                      // 16 x running averages of duty CLK, duty DT, phase error
+    unsigned long _usStateEntered[4];      // Time each state of CLK DT was entered last
+    unsigned long _usLastRotarySample = 0;
+    unsigned long _usSampleInterval = 0;   // Given or measured (running average) sampling interval
+    unsigned long _usSampleIntervalSum = 0;  // 8 x measured sampling interval, 0 until the first interval
+    uint8_t _statesEntered = 0;            // Bit per state entered since analysis was enabled
+    bool _measureSampleInterval = true;
+    bool _rotarySampled = false;           // _usLastRotarySample valid
+    bool _quadAnalysis = false;
 };
 #endif
\ No newline at end of file
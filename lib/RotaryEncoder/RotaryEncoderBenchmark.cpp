@@ -0,0 +1,109 @@
+/**
+ * Module       RotaryEncoderBenchmark.cpp
+ *
+ * Purpose      Self benchmark of the decoding methods, see RotaryEncoderBenchmark.h
+ *
+ *              A sequence holds one period of samples, 4 samples of CLK DT per byte
+ *              (bits 1 0 of each pair, first sample in the lowest bits). It is const
+ *              and stays in flash on ESP32. Every sequence is fed for SAMPLES samples,
+ *              after a warm up that also lets the encoder adopt the configuration.
+ */
+#include "RotaryEncoderBenchmark.h"
+#include <stdio.h>
+
+#if defined(ARDUINO_ARCH_ESP32)
+static inline uint32_t _benchTicks() { return ESP.getCycleCount(); }
+static const char *TICK_UNIT = "CPU cycles";
+#else
+#include <chrono>
+static inline uint64_t _benchTicks()    // The TSC of x86 counts at a fixed rate, not CPU cycles, so ns
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+static const char *TICK_UNIT = "ns";
+#endif
+
+static const uint8_t SEQ_IDLE[]   = {0xFF};                                            // detent, no motion
+static const uint8_t SEQ_CLEAN[]  = {0xAA, 0x00, 0x55, 0xFF};                          // CW, 4 samples per quarter
+static const uint8_t SEQ_BOUNCY[] = {0xEE, 0xAA, 0x88, 0x00, 0x11, 0x55, 0x77, 0xFF};  // CW, 2 bounces per edge
+static const uint8_t SEQ_FAST[]   = {0xD2};                                            // CW, 1 sample per quarter
+
+struct BenchSequence
+{
+  const char *name;
+  const uint8_t *packed;
+  uint8_t bytes;
+};
+
+static const BenchSequence SEQUENCES[] =
+{
+  {"idle",   SEQ_IDLE,   sizeof(SEQ_IDLE)},
+  {"clean",  SEQ_CLEAN,  sizeof(SEQ_CLEAN)},
+  {"bouncy", SEQ_BOUNCY, sizeof(SEQ_BOUNCY)},
+  {"fast",   SEQ_FAST,   sizeof(SEQ_FAST)},
+};
+
+static const unsigned long SAMPLES = 16384;
+static const unsigned long WARMUP  = 64;
+static const unsigned long US_PASS = 10;       // simulated time between passes
+
+/**
+ * Feed count samples of the sequence, return the ticks spent
+ */
+static uint64_t _feedSequence(RotaryEncoder &encoder, const BenchSequence &seq, unsigned long count, unsigned long &us)
+{
+  unsigned long samplesPerPeriod = seq.bytes * 4UL;
+  unsigned long i = 0;
+  auto start = _benchTicks();
+  for (unsigned long n = 0; n < count; n++)
+  {
+    uint8_t ab = (seq.packed[i >> 2] >> ((i & 3) * 2)) & 0b11;
+    encoder.feed(ab >> 1, ab & 1, HIGH, us += US_PASS);
+    if (++i == samplesPerPeriod) i = 0;
+  }
+  return (uint64_t)(_benchTicks() - start);
+}
+
+/**
+ * Run a sequence on a new encoder, return the ticks per pass and the steps
+ */
+static uint64_t _run(bool byTable, unsigned long usButtonInterval, const BenchSequence &seq, long &steps)
+{
+  RotaryEncoder encoder;
+  RotaryEncoderConfig config;
+  config.debouncingByTable = byTable;
+  config.usRotaryInterval = 0;
+  config.usButtonInterval = usButtonInterval;
+  encoder.publishConfig(config);
+
+  unsigned long us = 0;
+  _feedSequence(encoder, SEQUENCES[0], WARMUP, us);    // at the detent, configuration adopted
+  long start = encoder.getPosition();
+  uint64_t ticks = _feedSequence(encoder, seq, SAMPLES, us);
+  steps = encoder.getPosition() - start;
+  return ticks;
+}
+
+void rotaryEncoderSelfBenchmark(BenchmarkPrintFunction print)
+{
+  char line[96];
+  snprintf(line, sizeof(line), "RotaryEncoder self benchmark, %lu samples per sequence, %s", SAMPLES, TICK_UNIT);
+  print(line);
+  print("method    sequence  steps   /sample     /step     /loop");
+
+  for (int byTable = 1; byTable >= 0; byTable--)
+  {
+    for (const BenchSequence &seq : SEQUENCES)
+    {
+      long steps, loopSteps;
+      uint64_t ticks = _run(byTable, 0, seq, steps);
+      uint64_t loopTicks = _run(byTable, RotaryEncoderConfig().usButtonInterval, seq, loopSteps);
+      char perStep[12] = "-";
+      if (steps != 0) snprintf(perStep, sizeof(perStep), "%.1f", (double)ticks / (steps < 0 ? -steps : steps));
+      snprintf(line, sizeof(line), "%-9s %-8s %6ld %9.1f %9s %9.1f",
+               byTable ? "table" : "cleaning", seq.name, steps,
+               (double)ticks / SAMPLES, perStep, (double)loopTicks / SAMPLES);
+      print(line);
+    }
+  }
+}
@@ -0,0 +1,26 @@
+/**
+ * Header       RotaryEncoderBenchmark.h
+ *
+ * Purpose      Self benchmark of the decoding methods of RotaryEncoder on the target
+ *              (and, with the same code, on a host for comparison)
+ *
+ * Remarks      Built-in synthetic sample sequences (idle, clean, bouncy and fast
+ *              rotation) are fed by feed(), so no pins are read. Reported per
+ *              method and sequence:
+ *                 /sample   cost of one pass sampling rotary pins and button
+ *                 /step     cost per detected step
+ *                 /loop     cost of one pass with the default sampling intervals
+ *              in CPU cycles on ESP32 and in ns on hosts (the x86 TSC runs at a
+ *              fixed rate, its ticks are not CPU cycles either).
+ *              The result lines are passed to print, e.g.
+ *                 rotaryEncoderSelfBenchmark([](const char *line) { Serial.println(line); });
+ *              Takes some 100 ms on an ESP32, call it outside of time critical phases.
+ */
+#ifndef _ROTARYENCODERBENCHMARK_H_
+#define _ROTARYENCODERBENCHMARK_H_
+#include "RotaryEncoder.h"
+
+typedef void (*BenchmarkPrintFunction)(const char *line);
+
+void rotaryEncoderSelfBenchmark(BenchmarkPrintFunction print);
+#endif
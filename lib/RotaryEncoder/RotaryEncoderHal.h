@@ -0,0 +1,51 @@
+/**
+ * Header       RotaryEncoderHal.h
+ *
+ * Purpose      Hardware abstraction of the RotaryEncoder library. On Arduino this
+ *              is simply Arduino.h. On a host (Linux, unit tests, simulation) the
+ *              few Arduino functions used are provided here:
+ *              - pin functions and delayMicroseconds() do nothing, 
+ *                digitalRead() returns HIGH (button released)
+ *              - micros() and millis() run on the monotonic clock, which is also the
+ *                clock of the kernel timestamps of GPIO edge events
+ *
+ * Remarks      On a host, encoders are fed with samples by RotaryEncoder::feed()
+ *              instead of RotaryEncoder::loop().
+ */
+#ifndef _ROTARYENCODERHAL_H_
+#define _ROTARYENCODERHAL_H_
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stdint.h>
+#include <chrono>
+
+#ifndef HIGH
+#define HIGH 0x1
+#define LOW  0x0
+#endif
+#ifndef INPUT_PULLUP
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+#endif
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return HIGH; }
+inline void delayMicroseconds(unsigned int) {}
+
+inline unsigned long micros()
+{
+  return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline unsigned long millis()
+{
+  return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+#endif
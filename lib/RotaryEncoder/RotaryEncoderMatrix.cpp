@@ -0,0 +1,152 @@
+/**
+ * Class        RotaryEncoderMatrix.cpp
+ *
+ * Purpose      Scans a diode matrix of rotary encoders and feeds the table decoders.
+ *
+ * Wiring       Sense lines with pull up, a closed contact pulls its sense line low
+ *              through its diode only while its row is driven low. The other rows
+ *              are driven high, their diodes block. So the levels are the same as
+ *              with directly wired encoders.
+ *
+ *                 row 0 ----+-------------+-----------     (driven low when scanned)
+ *                           |             |
+ *                        encoder 0     encoder 1
+ *                         CLK  DT       CLK  DT
+ *                          |    |        |    |
+ *                         -^-  -^-      -^-  -^-          diodes, cathode at encoder
+ *              CLK col 0 --+----|--      |    |
+ *              DT  col 0 -------+--      |    |
+ *              CLK col 1 ----------------+----|--
+ *              DT  col 1 ---------------------+--
+ *
+ * Scan         row r low -> settle -> 1 port read -> row r high -> [common mode filter
+ *              of row r] -> feed cols of row r (encoders or cells)
+ */
+#include "RotaryEncoderMatrix.h"
+
+RotaryEncoderMatrix::RotaryEncoderMatrix(const uint8_t *rowPins, uint8_t rows,
+                                         const uint8_t *clkPins, const uint8_t *dataPins, uint8_t cols,
+                                         RotaryEncoder *encoders) :
+  _rowPins(rowPins),
+  _rows(rows > MAX_ROWS ? MAX_ROWS : rows),
+  _clkPins(clkPins),
+  _dataPins(dataPins),
+  _cols(cols > MAX_COLS ? MAX_COLS : cols),
+  _encoders(encoders)
+{
+}
+
+RotaryEncoderMatrix::RotaryEncoderMatrix(const uint8_t *rowPins, uint8_t rows,
+                                         const uint8_t *clkPins, const uint8_t *dataPins, uint8_t cols,
+                                         RotaryMatrixCell *cells) :
+  RotaryEncoderMatrix(rowPins, rows, clkPins, dataPins, cols, (RotaryEncoder *)nullptr)
+{
+  _cells = cells;
+}
+
+/**
+ * Replace reading the sense pins and driving the rows, e.g. for simulation
+ */
+void RotaryEncoderMatrix::setPortFunctions(MatrixReadFunction read, MatrixDriveFunction drive)
+{
+  _read  = read;
+  _drive = drive ? drive : _drivePin;
+}
+
+/**
+ * Mask sense line changes in a row read if at least threshold lines changed at once
+ */
+void RotaryEncoderMatrix::enableCommonModeFilter(bool enable, uint8_t threshold)
+{
+  uint32_t mask = 0;
+  for (uint8_t c = 0; c < _cols; c++) mask |= ((uint32_t)1 << _clkPins[c]) | ((uint32_t)1 << _dataPins[c]);
+  for (uint8_t r = 0; r < _rows; r++)
+  {
+    _filters[r] = RotaryCommonModeFilter(mask, threshold);
+    _filters[r].begin(mask);                          // Encoders at rest, all lines high
+  }
+  _commonModeFilter = enable;
+}
+
+uint32_t RotaryEncoderMatrix::getCommonModeRejections() const
+{
+  uint32_t rejections = 0;
+  for (uint8_t r = 0; r < _rows; r++) rejections += _filters[r].getRejections();
+  return rejections;
+}
+
+/**
+ * Configure the pins, all rows inactive (high), cells at the detent
+ */
+void RotaryEncoderMatrix::begin()
+{
+  if (_cells)
+    for (uint16_t i = 0; i < _rows * _cols; i++) _cells[i].decoder.setDetent();
+  for (uint8_t r = 0; r < _rows; r++)
+  {
+    pinMode(_rowPins[r], OUTPUT);
+    _drive(_rowPins[r], HIGH);
+  }
+  for (uint8_t c = 0; c < _cols; c++)
+  {
+    pinMode(_clkPins[c], INPUT_PULLUP);
+    pinMode(_dataPins[c], INPUT_PULLUP);
+  }
+}
+
+/**
+ * Scan all rows once
+ */
+void RotaryEncoderMatrix::loop()
+{
+  unsigned long usScan = micros();
+  _usScanPeriod = usScan - _usLastScan;
+  _usLastScan = usScan;
+  _scans++;
+
+  for (uint8_t r = 0; r < _rows; r++)
+  {
+    _drive(_rowPins[r], LOW);
+    if (_usSettle) delayMicroseconds(_usSettle);
+    uint32_t port = _read ? _read() : _readSensePins();
+    unsigned long usNow = micros();
+    _drive(_rowPins[r], HIGH);
+    if (_commonModeFilter) port = _filters[r].filter(port);
+
+    if (_cells)
+    {
+      RotaryMatrixCell *cell = &_cells[r * _cols];
+      for (uint8_t c = 0; c < _cols; c++, cell++)
+        cell->position += cell->decoder.decode((((port >> _clkPins[c]) & 1) << 1) | ((port >> _dataPins[c]) & 1));
+      continue;
+    }
+    RotaryEncoder *encoder = &_encoders[r * _cols];
+    for (uint8_t c = 0; c < _cols; c++, encoder++)
+    {
+      encoder->feed((port >> _clkPins[c]) & 1, (port >> _dataPins[c]) & 1, HIGH, usNow);
+    }
+  }
+}
+
+/**
+ * Read all sense pins at once
+ */
+uint32_t RotaryEncoderMatrix::_readSensePins() const
+{
+#ifdef ARDUINO_ARCH_ESP32
+  return REG_READ(GPIO_IN_REG);
+#else
+  uint32_t port = 0;                      // Fallback without port register, pin by pin
+  for (uint8_t c = 0; c < _cols; c++)
+  {
+    if (digitalRead(_clkPins[c]))  port |= (uint32_t)1 << _clkPins[c];
+    if (digitalRead(_dataPins[c])) port |= (uint32_t)1 << _dataPins[c];
+  }
+  return port;
+#endif
+}
+
+void RotaryEncoderMatrix::_drivePin(uint8_t pin, uint8_t level)
+{
+  digitalWrite(pin, level);
+}
@@ -0,0 +1,95 @@
+/**
+ * Header       RotaryEncoderMatrix.h
+ *
+ * Purpose      Scanner for many rotary encoders wired as a diode matrix: the common
+ *              pin of all encoders in a row is driven by a row line, the CLK and DT
+ *              contacts of all encoders in a column share a sense line each (with a
+ *              diode per contact).
+ *
+ * Constructor
+ * arguments    rowPins    output pins driving the rows
+ *              rows       number of rows (at most MAX_ROWS)
+ *              clkPins    input pins sensing CLK of the columns
+ *              dataPins   input pins sensing DT of the columns
+ *              cols       number of columns (at most MAX_COLS)
+ *              encoders   array of rows * cols encoders constructed without pins,
+ *                         encoder of row r and column c is encoders[r * cols + c]
+ *              or
+ *              cells      array of rows * cols RotaryMatrixCell, same order
+ *
+ * Remarks      Call RotaryEncoderMatrix::loop() instead of the loop() of the encoders,
+ *              it scans all rows. Per row one port read samples all columns, which are
+ *              then fed to the encoders of the row. Every encoder is sampled once per
+ *              scan, so the step rate per encoder is limited to 1 / (4 * scan period),
+ *              see getScanPeriod(). The scan period includes the settle time of every
+ *              row (setSettleTime(), default 2 us).
+ *              On ESP32 the sense pins must be below GPIO 32 (GPIO_IN_REG). Without the
+ *              flash, UART and output only pins about 16 of them are left, so a row
+ *              has at most MAX_COLS = 8 columns (16 sense lines).
+ *              A RotaryEncoder per cell brings button, callbacks and event buffer
+ *              (several hundred bytes each). For large panels RotaryMatrixCell
+ *              keeps only the table decoder and the position per encoder.
+ *              setPortFunctions() replaces port read and row drive, e.g. by RotaryMatrixSim.
+ *              enableCommonModeFilter() masks glitches hitting many sense lines of
+ *              a row at once (see RotaryCommonModeFilter.h).
+ */
+#ifndef _ROTARYENCODERMATRIX_H_
+#define _ROTARYENCODERMATRIX_H_
+#include "RotaryEncoder.h"
+#include "RotaryCommonModeFilter.h"
+
+typedef uint32_t (*MatrixReadFunction)();                      // Levels of all sense pins, bit n = pin n
+typedef void (*MatrixDriveFunction)(uint8_t pin, uint8_t level);
+
+/**
+ * Light matrix cell: table decoder and position, no button, callbacks or events
+ */
+struct RotaryMatrixCell
+{
+  TableDecoder decoder;
+  long position = 0;
+};
+
+class RotaryEncoderMatrix
+{
+  public:
+    RotaryEncoderMatrix(const uint8_t *rowPins, uint8_t rows,
+                        const uint8_t *clkPins, const uint8_t *dataPins, uint8_t cols,
+                        RotaryEncoder *encoders);
+    RotaryEncoderMatrix(const uint8_t *rowPins, uint8_t rows,
+                        const uint8_t *clkPins, const uint8_t *dataPins, uint8_t cols,
+                        RotaryMatrixCell *cells);
+
+    void setPortFunctions(MatrixReadFunction read, MatrixDriveFunction drive);
+    void setSettleTime(unsigned int usSettle) { _usSettle = usSettle; }  // Wait after driving a row
+    unsigned int getSettleTime() const { return _usSettle; }
+    void enableCommonModeFilter(bool enable = true, uint8_t threshold = 3);  // Lines changed at once in a row considered a glitch
+    uint32_t getCommonModeRejections() const;
+    void begin();
+    void loop();
+    unsigned long getScanPeriod() const { return _usScanPeriod; }       // Time between the last two scans
+    unsigned long getScanCount() const { return _scans; }
+
+    static const uint8_t MAX_ROWS = 16;
+    static const uint8_t MAX_COLS = 8;      // 2 sense lines each, all in GPIO_IN_REG
+
+  private:
+    uint32_t _readSensePins() const;
+    static void _drivePin(uint8_t pin, uint8_t level);
+    const uint8_t *_rowPins;
+    uint8_t _rows;
+    const uint8_t *_clkPins;
+    const uint8_t *_dataPins;
+    uint8_t _cols;
+    RotaryEncoder *_encoders;
+    RotaryMatrixCell *_cells = nullptr;    // Instead of _encoders
+    MatrixReadFunction _read = nullptr;    // nullptr = _readSensePins()
+    MatrixDriveFunction _drive = _drivePin;
+    unsigned int _usSettle = 2;
+    unsigned long _usLastScan = 0;
+    unsigned long _usScanPeriod = 0;
+    unsigned long _scans = 0;
+    bool _commonModeFilter = false;
+    RotaryCommonModeFilter _filters[MAX_ROWS];   // Per row, each row read is a snapshot of its own
+};
+#endif
@@ -0,0 +1,219 @@
+/**
+ * Class        RotaryEncoderSim.cpp
+ *
+ * Purpose      Event driven simulation of a RotaryEncoder, see RotaryEncoderSim.h
+ *
+ *              Passes are at usStart + k * usPollPeriod. With sampling interval I a
+ *              channel is sampled in the first pass of each slot of length I (grid
+ *              given by the encoder's anchor). Input levels held since the last
+ *              sample of a channel leave the encoder unchanged, so the next pass
+ *              that matters is the earliest of
+ *                 - rotary: first pass sampling it at or after its next input edge
+ *                 - button: the same, or at or after the click deadline
+ *              and for a channel not sampled yet its first sampling pass.
+ *              Before running a pass t which does not start a slot of channel c,
+ *              the pass f that does is run first if c's input changed in (f, t],
+ *              as the dense simulation samples c in f and not in t.
+ */
+#include "RotaryEncoderSim.h"
+#include <algorithm>
+
+RotaryEncoderSim::RotaryEncoderSim(RotaryEncoder &encoder, unsigned long usPollPeriod, unsigned long usStart) :
+  _encoder(encoder),
+  _usPeriod(usPollPeriod ? usPollPeriod : 1),
+  _usStart(usStart)
+{}
+
+/**
+ * Input levels from time us on
+ */
+void RotaryEncoderSim::setLevels(unsigned long us, uint8_t clk, uint8_t data, uint8_t button)
+{
+  const SimLevels &prev = _levels.empty() ? _initial : _levels.back();
+  uint8_t changed = (clk != prev.clk || data != prev.data ? 1 << ROTARY : 0) |
+                    (button != prev.button ? 1 << BUTTON : 0);
+  if (! changed) return;
+  if (! _levels.empty() && _levels.back().us == us)
+  {
+    _levels.back() = {us, clk, data, button, (uint8_t)(_levels.back().changed | changed)};
+    return;
+  }
+  _levels.push_back({us, clk, data, button, changed});
+}
+
+/**
+ * Turn by steps detents (clockwise positive) in quarter steps of usStep / 4
+ */
+unsigned long RotaryEncoderSim::turn(unsigned long us, int steps, unsigned long usStep)
+{
+  static const uint8_t cw[4][2] = {{1, 0}, {0, 0}, {0, 1}, {1, 1}};  // CLK DT after each quarter from the detent
+  uint8_t button = _levels.empty() ? _initial.button : _levels.back().button;
+  int count = steps < 0 ? -steps : steps;
+  for (int s = 0; s < count; s++)
+    for (int q = 0; q < 4; q++)
+    {
+      const uint8_t *levels = cw[steps > 0 ? q : (2 - q) & 3];
+      us += usStep / 4;
+      setLevels(us, levels[0], levels[1], button);
+    }
+  return us;
+}
+
+/**
+ * Press the button for usHold
+ */
+unsigned long RotaryEncoderSim::press(unsigned long us, unsigned long usHold)
+{
+  const SimLevels &last = _levels.empty() ? _initial : _levels.back();
+  uint8_t clk = last.clk, data = last.data;
+  setLevels(us, clk, data, LOW);
+  setLevels(us + usHold, clk, data, HIGH);
+  return us + usHold;
+}
+
+/**
+ * Run the passes that can change the encoder up to usEnd
+ */
+void RotaryEncoderSim::run(unsigned long usEnd)
+{
+  if (! _started)
+  {
+    if (_usStart > usEnd) return;
+    _feed(_usStart);
+  }
+  for (;;)
+  {
+    unsigned long next = NEVER;
+    for (uint8_t channel = ROTARY; channel <= BUTTON; channel++)
+    {
+      unsigned long usEdge = _pendingChange(channel);
+      if (usEdge != NEVER) next = std::min(next, _samplePass(channel, usEdge));
+    }
+    unsigned long usDeadline;
+    if (_encoder.getClickDeadline(usDeadline)) next = std::min(next, _samplePass(BUTTON, usDeadline));
+    if (next == NEVER || next > usEnd) break;
+    _visit(next);
+  }
+}
+
+/**
+ * Feed the encoder at every pass up to usEnd
+ */
+void RotaryEncoderSim::runDense(unsigned long usEnd)
+{
+  unsigned long us = _started ? _usLast + _usPeriod : _usStart;
+  for ( ; us <= usEnd; us += _usPeriod) _feed(us);
+}
+
+/**
+ * Run pass usPass, preceded by the passes starting the current slots if needed
+ */
+void RotaryEncoderSim::_visit(unsigned long usPass)
+{
+  for (bool again = true; again; )
+  {
+    again = false;
+    for (uint8_t channel = ROTARY; channel <= BUTTON; channel++)
+    {
+      unsigned long usSlot = _slotPass(channel, usPass);
+      if (usSlot >= usPass || usSlot <= _usLast) continue;
+      unsigned long usDeadline;
+      if (_changedBetween(channel, usSlot, usPass) ||
+          (channel == BUTTON && _encoder.getClickDeadline(usDeadline) && usDeadline > usSlot && usDeadline <= usPass))
+      {
+        _visit(usSlot);
+        again = true;
+      }
+    }
+  }
+  _feed(usPass);
+}
+
+void RotaryEncoderSim::_feed(unsigned long usPass)
+{
+  unsigned long anchors[2];
+  _encoder.getSamplingAnchors(anchors[ROTARY], anchors[BUTTON]);
+  const SimLevels &levels = _levelsAt(usPass);
+  _encoder.feed(levels.clk, levels.data, levels.button, usPass);
+  _feeds++;
+  _usLast = usPass;
+  _started = true;
+  for (uint8_t channel = ROTARY; channel <= BUTTON; channel++)
+    if (_interval(channel) == 0 || _anchor(channel) != anchors[channel]) _usSampled[channel] = usPass;
+}
+
+const SimLevels &RotaryEncoderSim::_levelsAt(unsigned long us) const
+{
+  auto it = std::upper_bound(_levels.begin(), _levels.end(), us,
+                             [](unsigned long t, const SimLevels &l) { return t < l.us; });
+  return it == _levels.begin() ? _initial : *(it - 1);
+}
+
+/**
+ * Time of the first input change of channel not yet seen by a sample, NEVER if none.
+ * A channel never sampled has its initial levels pending, the decoder has not seen them.
+ */
+unsigned long RotaryEncoderSim::_pendingChange(uint8_t channel)
+{
+  unsigned long usSampled = _usSampled[channel];
+  if (usSampled == NEVER) return _usStart;
+  size_t &i = _next[channel];
+  while (i < _levels.size() && (! (_levels[i].changed & (1 << channel)) || _levels[i].us <= usSampled)) i++;
+  return i < _levels.size() ? _levels[i].us : NEVER;
+}
+
+bool RotaryEncoderSim::_changedBetween(uint8_t channel, unsigned long usFrom, unsigned long usTo) const
+{
+  auto it = std::upper_bound(_levels.begin(), _levels.end(), usFrom,
+                             [](unsigned long t, const SimLevels &l) { return t < l.us; });
+  for ( ; it != _levels.end() && it->us <= usTo; ++it)
+    if (it->changed & (1 << channel)) return true;
+  return false;
+}
+
+/**
+ * First pass at or after us
+ */
+unsigned long RotaryEncoderSim::_firstPass(unsigned long us) const
+{
+  if (us <= _usStart) return _usStart;
+  unsigned long k = (us - _usStart + _usPeriod - 1) / _usPeriod;
+  return _usStart + k * _usPeriod;
+}
+
+/**
+ * First pass of the sampling slot of channel that contains pass usPass
+ */
+unsigned long RotaryEncoderSim::_slotPass(uint8_t channel, unsigned long usPass) const
+{
+  unsigned long interval = _interval(channel);
+  if (interval == 0) return usPass;
+  unsigned long anchor = _anchor(channel);
+  return _firstPass(anchor + (usPass - anchor) / interval * interval);
+}
+
+/**
+ * First pass from us on (and after the last pass run) which samples channel
+ */
+unsigned long RotaryEncoderSim::_samplePass(uint8_t channel, unsigned long us) const
+{
+  if (us == NEVER) return NEVER;
+  unsigned long pass = _firstPass(std::max(us, _usLast + 1));
+  unsigned long interval = _interval(channel);
+  if (interval == 0 || _slotPass(channel, pass) == pass) return pass;
+  unsigned long anchor = _anchor(channel);
+  return _firstPass(anchor + ((pass - anchor) / interval + 1) * interval);
+}
+
+unsigned long RotaryEncoderSim::_interval(uint8_t channel) const
+{
+  const RotaryEncoderConfig &config = _encoder.getConfig();
+  return channel == ROTARY ? config.usRotaryInterval : config.usButtonInterval;
+}
+
+unsigned long RotaryEncoderSim::_anchor(uint8_t channel) const
+{
+  unsigned long rotary, button;
+  _encoder.getSamplingAnchors(rotary, button);
+  return channel == ROTARY ? rotary : button;
+}
@@ -0,0 +1,83 @@
+/**
+ * Header       RotaryEncoderSim.h
+ *
+ * Purpose      Discrete event simulation of a RotaryEncoder fed by feed(), e.g. for
+ *              soak tests of hours of knob usage on a host. Instead of feeding the
+ *              encoder at every poll, time advances directly to the next pass that
+ *              can change its state:
+ *                 - the first pass sampling a channel after one of its input edges
+ *                 - the first button sample after a click deadline (getClickDeadline())
+ *                 - the first pass sampling a channel at all (initial levels)
+ *              The result (steps, clicks, callbacks, event timestamps) is identical
+ *              to runDense(), which feeds the encoder at every poll.
+ *
+ * Constructor
+ * arguments    encoder       encoder to simulate, usually constructed without pins
+ *              usPollPeriod  period of the simulated loop() passes
+ *              usStart       time of the first pass
+ *
+ * Remarks      Skipped passes would sample unchanged levels only. Before a pass the
+ *              simulator also runs the first pass of each channel's current sampling
+ *              slot if that one would have seen other levels, so the slots of the
+ *              encoder (setSamplingIntervals()) advance as in the dense simulation.
+ *              Inputs are given as levels from a time on (setLevels(), turn(), press()),
+ *              in ascending order and later than the passes already simulated.
+ *              Not covered: configuration changes during a run and the measured
+ *              sampling interval of enableQuadratureAnalysis(), which counts every pass.
+ *              On a host unsigned long has 64 bit, the simulated time does not wrap.
+ */
+#ifndef _ROTARYENCODERSIM_H_
+#define _ROTARYENCODERSIM_H_
+#include "RotaryEncoder.h"
+#include <vector>
+
+struct SimLevels
+{
+  unsigned long us;   // Levels from this time on
+  uint8_t clk;
+  uint8_t data;
+  uint8_t button;
+  uint8_t changed;    // Channels changed against the previous levels, bit 0 rotary, bit 1 button
+};
+
+class RotaryEncoderSim
+{
+  public:
+    RotaryEncoderSim(RotaryEncoder &encoder, unsigned long usPollPeriod = 1, unsigned long usStart = 0);
+
+    void setLevels(unsigned long us, uint8_t clk, uint8_t data, uint8_t button);
+    unsigned long turn(unsigned long us, int steps, unsigned long usStep);  // Quarter steps every usStep / 4, returns end time
+    unsigned long press(unsigned long us, unsigned long usHold);            // Returns release time
+
+    void run(unsigned long usEnd);       // Event driven up to the last pass <= usEnd
+    void runDense(unsigned long usEnd);  // Reference, every pass
+    unsigned long getFeeds() const { return _feeds; }
+    unsigned long getTime() const { return _usLast; }  // Time of the last pass simulated
+
+    static const unsigned long NEVER = ~0UL;
+
+  private:
+    enum { ROTARY, BUTTON };
+    void _visit(unsigned long usPass);
+    void _feed(unsigned long usPass);
+    const SimLevels &_levelsAt(unsigned long us) const;
+    unsigned long _pendingChange(uint8_t channel);
+    bool _changedBetween(uint8_t channel, unsigned long usFrom, unsigned long usTo) const;
+    unsigned long _firstPass(unsigned long us) const;
+    unsigned long _slotPass(uint8_t channel, unsigned long usPass) const;
+    unsigned long _samplePass(uint8_t channel, unsigned long us) const;
+    unsigned long _interval(uint8_t channel) const;
+    unsigned long _anchor(uint8_t channel) const;
+
+    RotaryEncoder &_encoder;
+    unsigned long _usPeriod;
+    unsigned long _usStart;
+    unsigned long _usLast = 0;
+    bool _started = false;
+    unsigned long _feeds = 0;
+    std::vector<SimLevels> _levels;
+    SimLevels _initial = {0, HIGH, HIGH, HIGH, 0};
+    size_t _next[2] = {0, 0};            // Per channel first input change possibly not sampled yet
+    unsigned long _usSampled[2] = {NEVER, NEVER};  // Per channel last pass sampling it
+};
+#endif
@@ -0,0 +1,242 @@
+/**
+ * Module       RotaryEncoderUlp.cpp
+ *
+ * Purpose      ULP coprocessor program decoding the rotary encoder in deep sleep.
+ *
+ * ULP program  Runs every usPeriod, registers are 16 bit wide:
+ *              R3 = base address of the variables in RTC slow memory
+ *              R1 = newTransition = ((newTransition << 2) | clk << 1 | dt) & 0xf
+ *              R0 = (ULP_VALID_TRANSITIONS >> R1) & 1, invalid transitions are ignored
+ *              R2 = transitions = ((transitions << 4) | R1) & 0xff
+ *                   0x17 (T3T4) -> delta++, 0x2b (t3t4) -> delta--
+ *                   |delta| >= threshold -> wake up main cores
+ *              SW low (pressed) -> button = 1, wake up main cores
+ *              After waking up the main cores the ULP timer is stopped.
+ *
+ *              ulpEncoderEmulate() does exactly the same in C++ with 16 bit arithmetic.
+ *              Keep both in sync.
+ */
+#include "RotaryEncoderUlp.h"
+
+/**
+ * One run of the ULP program, returns true when the main cores would be woken up
+ */
+bool ulpEncoderEmulate(UlpEncoderState &state, uint8_t clk, uint8_t data, uint8_t button, uint16_t threshold)
+{
+  uint16_t index = (uint16_t)((state.newTransition << 2) | (clk ? 0b10 : 0) | (data ? 0b01 : 0)) & 0xf;
+  state.newTransition = index;
+
+  if ((ULP_VALID_TRANSITIONS >> index) & 1)
+  {
+    state.transitions = (uint16_t)((state.transitions << 4) | index) & 0xff;
+    bool stepped = true;
+    if      (state.transitions == 0x17) state.delta++;
+    else if (state.transitions == 0x2b) state.delta--;
+    else stepped = false;
+
+    if (stepped)
+    {
+      uint16_t magnitude = state.delta < 0x8000 ? state.delta : (uint16_t)(0 - state.delta);
+      if (magnitude >= threshold) return true;
+    }
+  }
+
+  if (button == LOW)
+  {
+    state.button = 1;
+    return true;
+  }
+  return false;
+}
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <esp32/ulp.h>
+#include <driver/rtc_io.h>
+#include <soc/rtc_cntl_reg.h>
+#include <soc/rtc_io_reg.h>
+#include <esp_sleep.h>
+
+// Word addresses in RTC slow memory
+enum UlpEncoderVar
+{
+  VAR_TRANSITION,
+  VAR_TRANSITIONS,
+  VAR_DELTA,
+  VAR_BUTTON,
+  VAR_PIN_CLK,
+  VAR_PIN_DATA,
+  VAR_PIN_BUTTON,
+  VAR_MAGIC,
+  VAR_COUNT
+};
+const uint32_t ULP_PROG_ADDR = 16;       // Program is loaded behind the variables
+const uint16_t ULP_MAGIC = 0x5245;       // Marks the variables valid after a deep sleep
+
+enum UlpEncoderLabel
+{
+  LBL_BUTTON,
+  LBL_CW,
+  LBL_CCW,
+  LBL_THRESHOLD,
+  LBL_NEGATIVE,
+  LBL_DONE,
+  LBL_WAKE
+};
+
+static int _rtcIoNumber(uint8_t pin)
+{
+#if defined(ESP_IDF_VERSION_MAJOR) && ESP_IDF_VERSION_MAJOR >= 4
+  return rtc_io_number_get((gpio_num_t)pin);
+#else
+  return rtc_gpio_desc[pin].rtc_num;
+#endif
+}
+
+static void _initRtcInput(uint8_t pin)
+{
+  rtc_gpio_init((gpio_num_t)pin);
+  rtc_gpio_set_direction((gpio_num_t)pin, RTC_GPIO_MODE_INPUT_ONLY);
+  rtc_gpio_pulldown_dis((gpio_num_t)pin);
+  rtc_gpio_pullup_en((gpio_num_t)pin);
+}
+
+/**
+ * Load and start the ULP program with the current table decoder state of the encoder
+ */
+bool ulpEncoderStart(RotaryEncoder &encoder, uint8_t pinClk, uint8_t pinData, uint8_t pinButton,
+                     uint16_t threshold, uint32_t usPeriod)
+{
+  bool hasButton = pinButton != ULP_ENCODER_NO_BUTTON;
+  if (! rtc_gpio_is_valid_gpio((gpio_num_t)pinClk) || ! rtc_gpio_is_valid_gpio((gpio_num_t)pinData)) return false;
+  if (hasButton && ! rtc_gpio_is_valid_gpio((gpio_num_t)pinButton)) return false;
+  if (threshold == 0) threshold = 1;
+
+  uint32_t clkBit  = RTC_GPIO_IN_NEXT_S + _rtcIoNumber(pinClk);
+  uint32_t dataBit = RTC_GPIO_IN_NEXT_S + _rtcIoNumber(pinData);
+  uint32_t btnBit  = hasButton ? RTC_GPIO_IN_NEXT_S + _rtcIoNumber(pinButton) : 0;
+
+  const ulp_insn_t readButton[] = { I_RD_REG(RTC_GPIO_IN_REG, btnBit, btnBit) };
+  const ulp_insn_t noButton[]   = { I_MOVI(R0, HIGH) };   // encoder without pushbutton: never pressed
+
+  const ulp_insn_t program[] =
+  {
+    I_MOVI(R3, 0),                                      // R3 = base of variables
+    I_LD(R1, R3, VAR_TRANSITION),
+    I_LSHI(R1, R1, 2),                                  // shift previous transition 2 bits to the left
+    I_RD_REG(RTC_GPIO_IN_REG, clkBit, clkBit),
+    I_LSHI(R0, R0, 1),
+    I_ORR(R1, R1, R0),                                  // compose newTransition from clock
+    I_RD_REG(RTC_GPIO_IN_REG, dataBit, dataBit),
+    I_ORR(R1, R1, R0),                                  // and data
+    I_ANDI(R1, R1, 0xf),
+    I_ST(R1, R3, VAR_TRANSITION),
+    I_MOVI(R2, ULP_VALID_TRANSITIONS),
+    I_RSHR(R0, R2, R1),
+    I_ANDI(R0, R0, 1),
+    M_BL(LBL_BUTTON, 1),                                // invalid transition, ignore
+    I_LD(R2, R3, VAR_TRANSITIONS),
+    I_LSHI(R2, R2, 4),
+    I_ORR(R2, R2, R1),                                  // add new transition
+    I_ANDI(R2, R2, 0xff),
+    I_ST(R2, R3, VAR_TRANSITIONS),
+    I_SUBI(R0, R2, 0x17),
+    M_BXZ(LBL_CW),                                      // full step in clockwise direction done (T3T4)
+    I_SUBI(R0, R2, 0x2b),
+    M_BXZ(LBL_CCW),                                     // full step in counterclockwise direction done (t3t4)
+    M_BX(LBL_BUTTON),
+
+    M_LABEL(LBL_CW),
+    I_LD(R0, R3, VAR_DELTA),
+    I_ADDI(R0, R0, 1),
+    I_ST(R0, R3, VAR_DELTA),
+    M_BX(LBL_THRESHOLD),
+
+    M_LABEL(LBL_CCW),
+    I_LD(R0, R3, VAR_DELTA),
+    I_SUBI(R0, R0, 1),
+    I_ST(R0, R3, VAR_DELTA),
+
+    M_LABEL(LBL_THRESHOLD),                             // R0 = delta
+    M_BGE(LBL_NEGATIVE, 0x8000),
+    M_BGE(LBL_WAKE, threshold),
+    M_BX(LBL_BUTTON),
+    M_LABEL(LBL_NEGATIVE),
+    I_MOVI(R2, 0),
+    I_SUBR(R0, R2, R0),                                 // R0 = -delta
+    M_BGE(LBL_WAKE, threshold),
+
+    M_LABEL(LBL_BUTTON),
+    hasButton ? readButton[0] : noButton[0],
+    M_BGE(LBL_DONE, 1),                                 // released
+    I_MOVI(R0, 1),
+    I_ST(R0, R3, VAR_BUTTON),
+    M_BX(LBL_WAKE),
+
+    M_LABEL(LBL_DONE),
+    I_HALT(),
+
+    M_LABEL(LBL_WAKE),                                  // wait until the SoC is ready for wake up
+    I_RD_REG(RTC_CNTL_LOW_POWER_ST_REG, RTC_CNTL_RDY_FOR_WAKEUP_S, RTC_CNTL_RDY_FOR_WAKEUP_S),
+    I_ANDI(R0, R0, 1),
+    M_BXZ(LBL_WAKE),
+    I_WAKE(),
+    I_END(),                                            // stop the ULP timer
+    I_HALT()
+  };
+
+  uint8_t newTransition;
+  uint16_t transitions;
+  encoder.getTableState(newTransition, transitions);
+  RTC_SLOW_MEM[VAR_TRANSITION]  = newTransition;
+  RTC_SLOW_MEM[VAR_TRANSITIONS] = transitions & 0xff;
+  RTC_SLOW_MEM[VAR_DELTA]       = 0;
+  RTC_SLOW_MEM[VAR_BUTTON]      = 0;
+  RTC_SLOW_MEM[VAR_PIN_CLK]     = pinClk;
+  RTC_SLOW_MEM[VAR_PIN_DATA]    = pinData;
+  RTC_SLOW_MEM[VAR_PIN_BUTTON]  = pinButton;
+  RTC_SLOW_MEM[VAR_MAGIC]       = ULP_MAGIC;
+
+  _initRtcInput(pinClk);
+  _initRtcInput(pinData);
+  if (hasButton) _initRtcInput(pinButton);
+  esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON);   // keep pull ups powered
+
+  size_t size = sizeof(program) / sizeof(ulp_insn_t);
+  if (ulp_process_macros_and_load(ULP_PROG_ADDR, program, &size) != ESP_OK) return false;
+  if (ulp_set_wakeup_period(0, usPeriod) != ESP_OK) return false;
+  if (esp_sleep_enable_ulp_wakeup() != ESP_OK) return false;
+  return ulp_run(ULP_PROG_ADDR) == ESP_OK;
+}
+
+/**
+ * Call this in setup() after waking up from deep sleep. Stops the ULP program,
+ * restores the table decoder state of the encoder and dispatches the steps
+ * counted by the ULP. Returns false if the ULP program had not been started.
+ */
+bool ulpEncoderResume(RotaryEncoder &encoder, bool *wokenByButton)
+{
+  if ((RTC_SLOW_MEM[VAR_MAGIC] & 0xffff) != ULP_MAGIC) return false;
+  RTC_SLOW_MEM[VAR_MAGIC] = 0;
+
+  CLEAR_PERI_REG_MASK(RTC_CNTL_STATE0_REG, RTC_CNTL_ULP_CP_SLP_TIMER_EN);  // stop ULP timer
+  delayMicroseconds(100);                                                   // let a running pass finish
+
+  uint8_t pins[3] = { (uint8_t)RTC_SLOW_MEM[VAR_PIN_CLK],
+                      (uint8_t)RTC_SLOW_MEM[VAR_PIN_DATA],
+                      (uint8_t)RTC_SLOW_MEM[VAR_PIN_BUTTON] };
+  for (uint8_t pin : pins)
+  {
+    if (pin == ULP_ENCODER_NO_BUTTON) continue;
+    rtc_gpio_deinit((gpio_num_t)pin);
+    pinMode(pin, INPUT_PULLUP);
+  }
+
+  encoder.setTableState(RTC_SLOW_MEM[VAR_TRANSITION] & 0xf, RTC_SLOW_MEM[VAR_TRANSITIONS] & 0xff);
+  if (wokenByButton) *wokenByButton = RTC_SLOW_MEM[VAR_BUTTON] & 1;
+  int16_t delta = (int16_t)(RTC_SLOW_MEM[VAR_DELTA] & 0xffff);
+  RTC_SLOW_MEM[VAR_DELTA]  = 0;
+  RTC_SLOW_MEM[VAR_BUTTON] = 0;
+  encoder.replaySteps(delta);
+  return true;
+}
+#endif
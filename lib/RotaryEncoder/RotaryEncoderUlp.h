@@ -0,0 +1,50 @@
+/**
+ * Header       RotaryEncoderUlp.h
+ *
+ * Purpose      Decoding of a rotary encoder by the ESP32 ULP coprocessor while
+ *              the main cores are in deep sleep
+ *
+ * Functions    ulpEncoderStart()    hand the table decoder state of the encoder over
+ *                                   to the ULP program and start it, call this right
+ *                                   before esp_deep_sleep_start()
+ *              ulpEncoderResume()   after wake up, continue with the state of the ULP
+ *                                   program and dispatch the steps counted meanwhile
+ *              ulpEncoderEmulate()  one run of the ULP program, portable C++ for
+ *                                   testing the program logic on the host
+ *
+ * Remarks      The ULP program runs every usPeriod microseconds, samples CLK and DT
+ *              once and applies the valid transition table of TableDecoder
+ *              (RotaryDecoders.h). Full steps are accumulated
+ *              as delta in RTC slow memory. The main cores are woken up when |delta|
+ *              reaches the threshold or the pushbutton is pressed.
+ *
+ *              All 4 quadrature states of a step must be sampled at least once, so the
+ *              step rate is limited to 1 / (4 * usPeriod) for an ideal signal and less
+ *              for asymmetric ones, e.g. 250 steps/s at usPeriod = 1000.
+ *              CLK, DT and SW must be RTC capable pins (e.g. GPIO 25, 26, 27).
+ */
+#ifndef _ROTARYENCODERULP_H_
+#define _ROTARYENCODERULP_H_
+#include "RotaryEncoder.h"
+
+const uint8_t ULP_ENCODER_NO_BUTTON = 0xFF;
+const uint16_t ULP_VALID_TRANSITIONS = ROTARY_VALID_TRANSITIONS;   // Loaded into a ULP register as immediate
+
+// State of the ULP program in RTC slow memory, the ULP works with 16 bit words
+struct UlpEncoderState
+{
+  uint16_t newTransition;  // Index into the valid transition table
+  uint16_t transitions;    // Last two valid transitions
+  uint16_t delta;          // Accumulated steps, two's complement
+  uint16_t button;         // 1 when woken up by the pushbutton
+};
+
+bool ulpEncoderEmulate(UlpEncoderState &state, uint8_t clk, uint8_t data, uint8_t button, uint16_t threshold);
+
+#ifdef ARDUINO_ARCH_ESP32
+bool ulpEncoderStart(RotaryEncoder &encoder, uint8_t pinClk, uint8_t pinData,
+                     uint8_t pinButton = ULP_ENCODER_NO_BUTTON,
+                     uint16_t threshold = 1, uint32_t usPeriod = 1000);
+bool ulpEncoderResume(RotaryEncoder &encoder, bool *wokenByButton = nullptr);
+#endif
+#endif
@@ -0,0 +1,130 @@
+/**
+ * Class        RotaryEventMerger.cpp
+ *
+ * Purpose      k-way merge of the event buffers of several rotary encoders.
+ *
+ *              Each encoder buffer is already in chronological order, so only
+ *              the oldest event (head) of every non empty buffer has to be compared.
+ *              The heads are kept in a binary min heap: taking the oldest event
+ *              costs O(log k), only buffers which were empty at the last call are
+ *              scanned for new events.
+ *
+ *              Reorder window: an event is only released when it is older than
+ *              usReorderWindow. An encoder polled after the others may still deliver
+ *              an earlier event within this window, which is then sorted in correctly.
+ *
+ * Remarks      Timestamps are compared by their difference, so the wrap around of
+ *              micros() after about 71 minutes does no harm.
+ */
+#include "RotaryEventMerger.h"
+
+RotaryEventMerger::RotaryEventMerger(RotaryEncoder *encoders[], uint8_t count, unsigned long usReorderWindow) :
+  _encoders(encoders),
+  _count(count > MAX_ENCODERS ? MAX_ENCODERS : count),
+  _usReorderWindow(usReorderWindow)
+{
+}
+
+/**
+ * Heap order: older event first, on equal timestamps the lower encoder index
+ */
+bool RotaryEventMerger::_before(uint8_t a, uint8_t b) const
+{
+  long diff = (long)(_usHead[a] - _usHead[b]);
+  return diff < 0 || (diff == 0 && a < b);
+}
+
+void RotaryEventMerger::_siftUp(uint8_t pos)
+{
+  while (pos > 0)
+  {
+    uint8_t parent = (pos - 1) / 2;
+    if (! _before(_heap[pos], _heap[parent])) break;
+    uint8_t tmp = _heap[pos]; _heap[pos] = _heap[parent]; _heap[parent] = tmp;
+    pos = parent;
+  }
+}
+
+void RotaryEventMerger::_siftDown(uint8_t pos)
+{
+  for (;;)
+  {
+    uint8_t smallest = pos;
+    uint8_t left  = 2 * pos + 1;
+    uint8_t right = left + 1;
+    if (left  < _heapSize && _before(_heap[left],  _heap[smallest])) smallest = left;
+    if (right < _heapSize && _before(_heap[right], _heap[smallest])) smallest = right;
+    if (smallest == pos) break;
+    uint8_t tmp = _heap[pos]; _heap[pos] = _heap[smallest]; _heap[smallest] = tmp;
+    pos = smallest;
+  }
+}
+
+/**
+ * Add the encoders which have got new events since they were last found empty
+ */
+void RotaryEventMerger::_collect()
+{
+  if (_heapSize == _count) return;
+  RotaryEvent head;
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if ((_inHeap >> i) & 1) continue;
+    if (! _encoders[i]->peekEvent(head)) continue;
+    _usHead[i] = head.us;
+    _inHeap |= (uint64_t)1 << i;
+    _heap[_heapSize] = i;
+    _siftUp(_heapSize++);
+  }
+}
+
+bool RotaryEventMerger::next(MergedRotaryEvent &event)
+{
+  return next(event, micros());
+}
+
+/**
+ * Get the oldest event of all encoders, if it is older than the reorder window
+ */
+bool RotaryEventMerger::next(MergedRotaryEvent &event, unsigned long usNow)
+{
+  RotaryEvent ev;
+  for (;;)
+  {
+    _collect();
+    if (_heapSize == 0) return false;
+    uint8_t i = _heap[0];
+    if (! _encoders[i]->peekEvent(ev))          // Buffer emptied by someone else, drop the encoder
+    {
+      _removeTop();
+      continue;
+    }
+    if (ev.us != _usHead[i])                    // Emptied and refilled meanwhile, reposition
+    {
+      _usHead[i] = ev.us;
+      _siftDown(0);
+      continue;
+    }
+    if ((long)(usNow - _usHead[i]) < (long)_usReorderWindow) return false;  // Too recent, wait
+
+    _encoders[i]->popEvent(ev);
+    event.us      = ev.us;
+    event.type    = ev.type;
+    event.encoder = i;
+
+    if (_encoders[i]->peekEvent(ev))            // Encoder has more events, reposition it
+    {
+      _usHead[i] = ev.us;
+      _siftDown(0);
+    }
+    else _removeTop();                          // Encoder empty, remove it from the heap
+    return true;
+  }
+}
+
+void RotaryEventMerger::_removeTop()
+{
+  _inHeap &= ~((uint64_t)1 << _heap[0]);
+  _heap[0] = _heap[--_heapSize];
+  _siftDown(0);
+}
@@ -0,0 +1,58 @@
+/**
+ * Header       RotaryEventMerger.h
+ *
+ * Purpose      Merges the timestamped events of several rotary encoders into
+ *              one stream in chronological order
+ *
+ * Constructor
+ * arguments    encoders         array of pointers to the encoders (at most MAX_ENCODERS)
+ *              count            number of encoders in the array
+ *              usReorderWindow  events are held back until they are older than this
+ *                               window, so that encoders polled later with earlier
+ *                               events can still be sorted in
+ *
+ * Remarks      The event buffers of the encoders must be enabled with
+ *              RotaryEncoder::enableEventBuffer(). Each encoder must be polled by its
+ *              loop() at least once within usReorderWindow, otherwise the order of
+ *              its events relative to the others is not guaranteed.
+ *              The merger must be the only consumer of the buffers: no popEvent(),
+ *              batch handler (addOnEventsCB()) or RotaryEncoderShmPublisher on the same
+ *              encoders. A buffer emptied anyway (also by enableEventBuffer()) is
+ *              detected and skipped, its events are lost for the merger.
+ */
+#ifndef _ROTARYEVENTMERGER_H_
+#define _ROTARYEVENTMERGER_H_
+#include "RotaryEncoder.h"
+
+struct MergedRotaryEvent
+{
+  unsigned long us;   // Timestamp of the event
+  uint8_t type;       // RotaryEventType
+  uint8_t encoder;    // Index of the encoder in the array passed to the constructor
+};
+
+class RotaryEventMerger
+{
+  public:
+    RotaryEventMerger(RotaryEncoder *encoders[], uint8_t count, unsigned long usReorderWindow = 2000);
+
+    bool next(MergedRotaryEvent &event);                     // Uses micros() as current time
+    bool next(MergedRotaryEvent &event, unsigned long usNow);
+
+    static const uint8_t MAX_ENCODERS = 64;
+
+  private:
+    void _collect();
+    bool _before(uint8_t a, uint8_t b) const;
+    void _siftUp(uint8_t pos);
+    void _siftDown(uint8_t pos);
+    void _removeTop();
+    RotaryEncoder **_encoders;
+    uint8_t _count;
+    unsigned long _usReorderWindow;
+    unsigned long _usHead[MAX_ENCODERS];   // Timestamp of the oldest event of each encoder in the heap
+    uint8_t _heap[MAX_ENCODERS];           // Min heap of encoder indices ordered by _usHead
+    uint8_t _heapSize = 0;
+    uint64_t _inHeap = 0;                  // Bit i set when encoder i is in the heap
+};
+#endif
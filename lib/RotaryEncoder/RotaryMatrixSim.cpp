@@ -0,0 +1,65 @@
+/**
+ * Class        RotaryMatrixSim.cpp
+ *
+ * Purpose      Simulated diode matrix of rotary encoders.
+ *
+ *              Quarter steps of an encoder and levels of CLK and DT (CW sequence):
+ *                 quarters & 3    0   1   2   3
+ *                 CLK DT          11  10  00  01
+ *              Sense lines are high unless a contact of the encoder in the row
+ *              being driven low pulls them low.
+ */
+#include "RotaryMatrixSim.h"
+
+RotaryMatrixSim *RotaryMatrixSim::_active = nullptr;
+
+RotaryMatrixSim::RotaryMatrixSim(const uint8_t *rowPins, uint8_t rows,
+                                 const uint8_t *clkPins, const uint8_t *dataPins, uint8_t cols) :
+  _rowPins(rowPins),
+  _rows(rows > RotaryEncoderMatrix::MAX_ROWS ? RotaryEncoderMatrix::MAX_ROWS : rows),
+  _clkPins(clkPins),
+  _dataPins(dataPins),
+  _cols(cols > RotaryEncoderMatrix::MAX_COLS ? RotaryEncoderMatrix::MAX_COLS : cols)
+{
+}
+
+void RotaryMatrixSim::attach(RotaryEncoderMatrix &matrix)
+{
+  _active = this;
+  matrix.setPortFunctions(_read, _drive);
+}
+
+void RotaryMatrixSim::turn(uint8_t encoder, int quarters)
+{
+  if (encoder < _rows * _cols) _quarters[encoder] += quarters;
+}
+
+uint32_t RotaryMatrixSim::_read()
+{
+  uint32_t port = 0xFFFFFFFF;
+  RotaryMatrixSim *sim = _active;
+  if (! sim || sim->_activeRow < 0) return port;
+
+  static const uint8_t levels[4] = {0b11, 0b10, 0b00, 0b01};
+  sim->_rowScans++;
+  const long *quarters = &sim->_quarters[sim->_activeRow * sim->_cols];
+  for (uint8_t c = 0; c < sim->_cols; c++)
+  {
+    uint8_t level = levels[quarters[c] & 3];
+    if (! (level & 0b10)) port &= ~((uint32_t)1 << sim->_clkPins[c]);
+    if (! (level & 0b01)) port &= ~((uint32_t)1 << sim->_dataPins[c]);
+  }
+  return port;
+}
+
+void RotaryMatrixSim::_drive(uint8_t pin, uint8_t level)
+{
+  RotaryMatrixSim *sim = _active;
+  if (! sim) return;
+  for (uint8_t r = 0; r < sim->_rows; r++)
+  {
+    if (sim->_rowPins[r] != pin) continue;
+    if (level == LOW) sim->_activeRow = r;
+    else if (sim->_activeRow == r) sim->_activeRow = -1;
+  }
+}
@@ -0,0 +1,47 @@
+/**
+ * Header       RotaryMatrixSim.h
+ *
+ * Purpose      Simulation of a diode matrix of rotary encoders for
+ *              RotaryEncoderMatrix, e.g. on a host. Replaces the port read
+ *              and row drive of the scanner by the levels of simulated encoders.
+ *
+ * Constructor
+ * arguments    same pins and dimensions as the RotaryEncoderMatrix to simulate
+ *
+ * Remarks      turn() moves a simulated encoder by quarter steps (4 quarters per
+ *              detent, clockwise positive), the scanner then sees the corresponding
+ *              quadrature levels while the row of the encoder is driven low.
+ *              Only one simulator can be attached at a time. Rows and columns are
+ *              limited like in RotaryEncoderMatrix, turn() ignores other encoders.
+ */
+#ifndef _ROTARYMATRIXSIM_H_
+#define _ROTARYMATRIXSIM_H_
+#include "RotaryEncoderMatrix.h"
+
+class RotaryMatrixSim
+{
+  public:
+    RotaryMatrixSim(const uint8_t *rowPins, uint8_t rows,
+                    const uint8_t *clkPins, const uint8_t *dataPins, uint8_t cols);
+
+    void attach(RotaryEncoderMatrix &matrix);
+    void turn(uint8_t encoder, int quarters);
+    long getQuarters(uint8_t encoder) const { return encoder < _rows * _cols ? _quarters[encoder] : 0; }
+    unsigned long getRowScans() const { return _rowScans; }
+
+    static const uint16_t MAX_ENCODERS = RotaryEncoderMatrix::MAX_ROWS * RotaryEncoderMatrix::MAX_COLS;
+
+  private:
+    static uint32_t _read();
+    static void _drive(uint8_t pin, uint8_t level);
+    static RotaryMatrixSim *_active;
+    const uint8_t *_rowPins;
+    uint8_t _rows;
+    const uint8_t *_clkPins;
+    const uint8_t *_dataPins;
+    uint8_t _cols;
+    int _activeRow = -1;
+    unsigned long _rowScans = 0;
+    long _quarters[MAX_ENCODERS] = {};
+};
+#endif
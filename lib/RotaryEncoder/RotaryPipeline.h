@@ -0,0 +1,157 @@
+/**
+ * Header       RotaryPipeline.h
+ *
+ * Purpose      Rotary encoder decoding composed of exchangeable stages
+ *
+ *                 source -> filter -> decoder -> post-processor -> sink
+ *
+ *              Every stage is a class with begin() and one function:
+ *                 Source    uint8_t read()                  CLK DT as bits 1 0
+ *                           unsigned long now()             time of the sample read (us)
+ *                 Filter    uint8_t filter(uint8_t ab)      cleaned CLK DT
+ *                 Decoder   int8_t  decode(uint8_t ab)      +1 CW, -1 CCW, 0 no full step
+ *                 Post      int16_t process(int8_t step, unsigned long usNow)
+ *                                                           steps to report (0 = none)
+ *                 Sink      void    emit(int16_t steps)
+ *              RotaryPipeline<Source, Filter, Decoder, Post, Sink>::loop() calls
+ *              them in this order, now() only for a full step. The stages are
+ *              template arguments, not virtual, so the compiler can inline the whole
+ *              pipeline into one loop function; test_pipeline compares it with a
+ *              hand-written loop of the table decoder.
+ *
+ * Example      RotaryPipeline<PinSource<25, 26>, NoFilter, TableDecoder,
+ *                             AccelerationPost<>, CounterSink> knob;
+ *              knob.begin();
+ *              ... knob.loop(); ... knob.sink.getPosition();
+ *
+ * Remarks      For pushbutton, events, chords and the other features use the
+ *              RotaryEncoder class, the pipeline covers the rotary part only. The
+ *              class is not built on the pipeline, the two share the decoders of
+ *              RotaryDecoders.h only.
+ *              Own stages need only the functions listed above.
+ */
+#ifndef _ROTARYPIPELINE_H_
+#define _ROTARYPIPELINE_H_
+#include "RotaryEncoderHal.h"
+#include "RotaryDecoders.h"
+
+/**
+ * Sources
+ */
+template <uint8_t PIN_CLK, uint8_t PIN_DATA>
+struct PinSource
+{
+  void begin() { pinMode(PIN_CLK, INPUT_PULLUP); pinMode(PIN_DATA, INPUT_PULLUP); }
+  uint8_t read() { return (digitalRead(PIN_CLK) ? 0b10 : 0) | (digitalRead(PIN_DATA) ? 0b01 : 0); }
+  unsigned long now() { return micros(); }
+};
+
+struct FedSource                // Levels set by the application, e.g. from a port snapshot
+{
+  void begin() {}
+  void set(uint8_t clk, uint8_t data, unsigned long usNow) { _ab = (clk ? 0b10 : 0) | (data ? 0b01 : 0); _us = usNow; }
+  void setBits(uint8_t ab, unsigned long usNow) { _ab = ab; _us = usNow; }   // CLK DT as bits 1 0
+  uint8_t read() { return _ab; }
+  unsigned long now() { return _us; }
+  uint8_t _ab = 0b11;
+  unsigned long _us = 0;
+};
+
+/**
+ * Filters
+ */
+struct NoFilter
+{
+  void begin() {}
+  uint8_t filter(uint8_t ab) { return ab; }
+};
+
+template <uint8_t SAMPLES = 3>  // Accept a new level only after SAMPLES equal samples
+struct StableFilter
+{
+  void begin() {}
+  uint8_t filter(uint8_t ab)
+  {
+    if (ab != _candidate) { _candidate = ab; _count = 0; }
+    if (_count < SAMPLES && ++_count == SAMPLES) _stable = ab;
+    return _stable;
+  }
+  uint8_t _candidate = 0b11;
+  uint8_t _stable = 0b11;
+  uint8_t _count = SAMPLES;
+};
+
+/**
+ * Decoders: TableDecoder and CleaningDecoder of RotaryDecoders.h, the same
+ * code the RotaryEncoder class runs
+ */
+
+/**
+ * Post-processors
+ */
+struct NoPost
+{
+  void begin() {}
+  int16_t process(int8_t step, unsigned long) { return step; }
+};
+
+template <unsigned long US_FAST = 5000, int16_t FACTOR = 10>  // Steps faster than US_FAST count FACTOR times
+struct AccelerationPost
+{
+  void begin() {}
+  int16_t process(int8_t step, unsigned long usNow)
+  {
+    if (step == 0) return 0;
+    bool fast = usNow - _usLastStep < US_FAST;
+    _usLastStep = usNow;
+    return fast ? step * FACTOR : step;
+  }
+  unsigned long _usLastStep = 0;
+};
+
+/**
+ * Sinks
+ */
+struct CounterSink
+{
+  void begin() {}
+  void emit(int16_t steps) { _position += steps; }
+  long getPosition() const { return _position; }
+  long _position = 0;
+};
+
+struct CallbackSink
+{
+  typedef void (*StepsFunction)(int16_t steps);
+  void begin() {}
+  void setCallback(StepsFunction onSteps) { _onSteps = onSteps; }
+  void emit(int16_t steps) { if (_onSteps) _onSteps(steps); }
+  StepsFunction _onSteps = nullptr;
+};
+
+/**
+ * The pipeline, the stages are accessible as members
+ */
+template <class Source, class Filter, class Decoder, class Post, class Sink>
+struct RotaryPipeline
+{
+  void begin()
+  {
+    source.begin(); filter.begin(); decoder.begin(); post.begin(); sink.begin();
+  }
+
+  void loop()
+  {
+    int8_t step = decoder.decode(filter.filter(source.read()));
+    if (step == 0) return;
+    int16_t steps = post.process(step, source.now());
+    if (steps) sink.emit(steps);
+  }
+
+  Source source;
+  Filter filter;
+  Decoder decoder;
+  Post post;
+  Sink sink;
+};
+#endif
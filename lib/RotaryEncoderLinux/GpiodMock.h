@@ -0,0 +1,74 @@
+/**
+ * Header       GpiodMock.h
+ *
+ * Purpose      Mock of the GPIO character device for testing RotaryEncoderGpiod
+ *              without hardware. Edges are queued with addEdge() and delivered
+ *              by readEdges() in batches, waitEdges() never sleeps.
+ */
+#ifndef _GPIODMOCK_H_
+#define _GPIODMOCK_H_
+#include "RotaryEncoderGpiod.h"
+#if defined(__linux__) && ! defined(ARDUINO)
+
+class GpiodMock : public GpiodInterface
+{
+  public:
+    static const size_t MAX_EDGES = 4096;
+    static const size_t MAX_LINES = 3;
+
+    // Queue an edge, returns false when the queue is full
+    bool addEdge(unsigned int offset, bool rising, uint64_t ns)
+    {
+      if (_tail - _head >= MAX_EDGES) return false;
+      _edges[_tail++ % MAX_EDGES] = {ns, offset, rising};
+      return true;
+    }
+
+    void setLevel(size_t line, uint8_t level) { if (line < MAX_LINES) _levels[line] = level; }
+    void setBatchSize(size_t batch) { _batch = batch ? batch : 1; }
+    size_t pending() const { return _tail - _head; }
+    bool isRequested() const { return _requested; }
+
+    bool request(const char *, const unsigned int *offsets, size_t count, unsigned long usDebounce) override
+    {
+      if (count > MAX_LINES) return false;
+      for (size_t i = 0; i < count; i++) _offsets[i] = offsets[i];
+      _count = count;
+      _usDebounce = usDebounce;
+      _requested = true;
+      return true;
+    }
+
+    bool getValues(uint8_t *values) override
+    {
+      for (size_t i = 0; i < _count; i++) values[i] = _levels[i];
+      return true;
+    }
+
+    int waitEdges(long) override { return pending() ? 1 : 0; }
+
+    int readEdges(GpioEdge *edges, size_t max) override
+    {
+      size_t count = 0;
+      while (count < max && count < _batch && _head != _tail)
+        edges[count++] = _edges[_head++ % MAX_EDGES];
+      return (int)count;
+    }
+
+    void release() override { _requested = false; }
+
+    unsigned long getDebounce() const { return _usDebounce; }
+
+  private:
+    GpioEdge _edges[MAX_EDGES];
+    size_t _head = 0;
+    size_t _tail = 0;
+    size_t _batch = 64;
+    unsigned int _offsets[MAX_LINES] = {0, 0, 0};
+    uint8_t _levels[MAX_LINES] = {HIGH, HIGH, HIGH};
+    size_t _count = 0;
+    unsigned long _usDebounce = 0;
+    bool _requested = false;
+};
+#endif
+#endif
@@ -0,0 +1,158 @@
+/**
+ * Class        RotaryEncoderGpiod.cpp
+ *
+ * Purpose      Feeds a RotaryEncoder with the edge events of the GPIO character
+ *              device. Each edge updates the level of its line and is passed to
+ *              RotaryEncoder::feed() with its kernel timestamp, in the order the
+ *              kernel recorded them. A batch of up to EDGE_BATCH_SIZE edges is read
+ *              per wake up, so at high step rates several steps cost one wake up.
+ *
+ * Remarks      The kernel timestamps are taken from CLOCK_MONOTONIC, the same clock
+ *              micros() of RotaryEncoderHal.h uses, so fed edges and timeouts share
+ *              one time base.
+ */
+#include "RotaryEncoderGpiod.h"
+#if defined(__linux__) && ! defined(ARDUINO)
+
+RotaryEncoderGpiod::RotaryEncoderGpiod(RotaryEncoder &encoder, GpiodInterface &gpio, const char *chip,
+                                       unsigned int lineClk, unsigned int lineData, unsigned int lineButton) :
+  _encoder(encoder),
+  _gpio(gpio),
+  _chip(chip),
+  _lines{lineClk, lineData, lineButton},
+  _lineCount(lineButton == NO_LINE ? 2 : 3)
+{
+}
+
+/**
+ * Request the lines as inputs with pull up and edge detection on both edges
+ * and take over their current levels. Every fed edge is sampled at once.
+ */
+bool RotaryEncoderGpiod::begin(unsigned long usKernelDebounce)
+{
+  end();
+  _encoder.setSamplingIntervals(0, 0);
+  if (! _gpio.request(_chip, _lines, _lineCount, usKernelDebounce)) return false;
+  _requested = true;
+  if (! _gpio.getValues(_levels))
+  {
+    end();
+    return false;
+  }
+  _encoder.feed(_levels[0], _levels[1], _levels[2], micros());
+  return true;
+}
+
+void RotaryEncoderGpiod::end()
+{
+  if (_requested) _gpio.release();
+  _requested = false;
+}
+
+/**
+ * Wait up to msTimeout for edges and feed them to the encoder
+ */
+int RotaryEncoderGpiod::poll(long msTimeout)
+{
+  if (! _requested) return -1;
+
+  int pending = _gpio.waitEdges(msTimeout);
+  _wakeups++;
+  if (pending < 0) return pending;
+  if (pending == 0)                  // Timeout, let the button timing proceed
+  {
+    _encoder.feed(_levels[0], _levels[1], _levels[2], micros());
+    return 0;
+  }
+
+  int count = _gpio.readEdges(_batch, EDGE_BATCH_SIZE);
+  for (int i = 0; i < count; i++)
+  {
+    const GpioEdge &edge = _batch[i];
+    for (size_t line = 0; line < _lineCount; line++)
+    {
+      if (_lines[line] == edge.offset) _levels[line] = edge.rising ? HIGH : LOW;
+    }
+    _encoder.feed(_levels[0], _levels[1], _levels[2], (unsigned long)(edge.ns / 1000));
+  }
+  if (count > 0) _edges += count;
+  return count;
+}
+
+#ifdef ROTARYENCODER_LIBGPIOD
+#include <gpiod.h>
+
+bool LibGpiod::request(const char *chip, const unsigned int *offsets, size_t count, unsigned long usDebounce)
+{
+  release();
+  _chip = gpiod_chip_open(chip);
+  if (! _chip) return false;
+
+  gpiod_line_settings *settings = gpiod_line_settings_new();
+  gpiod_line_config *lineConfig = gpiod_line_config_new();
+  gpiod_request_config *requestConfig = gpiod_request_config_new();
+  bool ok = settings && lineConfig && requestConfig;
+  if (ok)
+  {
+    gpiod_line_settings_set_direction(settings, GPIOD_LINE_DIRECTION_INPUT);
+    gpiod_line_settings_set_bias(settings, GPIOD_LINE_BIAS_PULL_UP);
+    gpiod_line_settings_set_edge_detection(settings, GPIOD_LINE_EDGE_BOTH);
+    gpiod_line_settings_set_event_clock(settings, GPIOD_LINE_CLOCK_MONOTONIC);
+    gpiod_line_settings_set_debounce_period_us(settings, usDebounce);
+    ok = gpiod_line_config_add_line_settings(lineConfig, offsets, count, settings) == 0;
+  }
+  if (ok)
+  {
+    gpiod_request_config_set_consumer(requestConfig, "RotaryEncoder");
+    gpiod_request_config_set_event_buffer_size(requestConfig, EVENT_BUFFER_SIZE);
+    _request = gpiod_chip_request_lines(_chip, requestConfig, lineConfig);
+    _buffer  = gpiod_edge_event_buffer_new(EVENT_BUFFER_SIZE);
+    ok = _request && _buffer;
+  }
+  if (requestConfig) gpiod_request_config_free(requestConfig);
+  if (lineConfig)    gpiod_line_config_free(lineConfig);
+  if (settings)      gpiod_line_settings_free(settings);
+
+  _count = count;
+  if (! ok) release();
+  return ok;
+}
+
+bool LibGpiod::getValues(uint8_t *values)
+{
+  gpiod_line_value lineValues[3];
+  if (_count > 3 || gpiod_line_request_get_values(_request, lineValues) != 0) return false;
+  for (size_t i = 0; i < _count; i++) values[i] = lineValues[i] == GPIOD_LINE_VALUE_ACTIVE ? HIGH : LOW;
+  return true;
+}
+
+int LibGpiod::waitEdges(long msTimeout)
+{
+  return gpiod_line_request_wait_edge_events(_request, (int64_t)msTimeout * 1000000);
+}
+
+int LibGpiod::readEdges(GpioEdge *edges, size_t max)
+{
+  if (max > EVENT_BUFFER_SIZE) max = EVENT_BUFFER_SIZE;
+  int count = gpiod_line_request_read_edge_events(_request, _buffer, max);
+  for (int i = 0; i < count; i++)
+  {
+    gpiod_edge_event *event = gpiod_edge_event_buffer_get_event(_buffer, i);
+    edges[i].ns     = gpiod_edge_event_get_timestamp_ns(event);
+    edges[i].offset = gpiod_edge_event_get_line_offset(event);
+    edges[i].rising = gpiod_edge_event_get_event_type(event) == GPIOD_EDGE_EVENT_RISING_EDGE;
+  }
+  return count;
+}
+
+void LibGpiod::release()
+{
+  if (_buffer)  gpiod_edge_event_buffer_free(_buffer);
+  if (_request) gpiod_line_request_release(_request);
+  if (_chip)    gpiod_chip_close(_chip);
+  _buffer  = nullptr;
+  _request = nullptr;
+  _chip    = nullptr;
+}
+#endif
+#endif
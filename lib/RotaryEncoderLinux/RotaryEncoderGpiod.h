@@ -0,0 +1,113 @@
+/**
+ * Header       RotaryEncoderGpiod.h
+ *
+ * Purpose      Linux backend of the RotaryEncoder class on the GPIO character
+ *              device (libgpiod v2). Instead of polling the pins, the edges of
+ *              CLK, DT and SW are read in batches with their kernel timestamps
+ *              and fed one by one to RotaryEncoder::feed(), so the decoding
+ *              methods run on the exact edge times.
+ *
+ * Constructor
+ * arguments    encoder     encoder constructed without pins, RotaryEncoder()
+ *              gpio        access to the GPIO character device, LibGpiod or a
+ *                          mock for tests (GpiodMock.h)
+ *              chip        path of the chip, e.g. "/dev/gpiochip0"
+ *              lineClk     line offset of clock
+ *              lineData    line offset of data
+ *              lineButton  line offset of pushbutton (optional)
+ *
+ * Remarks      Call poll() in your main loop. It sleeps until edges arrive or the
+ *              timeout expires; on timeout the encoder is fed once with the unchanged
+ *              levels so the pushbutton timing (click, double click) proceeds.
+ *              getEdgeCount() and getWakeupCount() count the edges processed and the
+ *              returns from waiting, e.g. to determine wake ups per step.
+ *              Every edge fed is a change of level, so sampling intervals gain nothing
+ *              here: begin() sets them to 0 (RotaryEncoder::setSamplingIntervals(0, 0)),
+ *              each edge is decoded at its own timestamp.
+ *
+ *              LibGpiod uses the libgpiod v2 API and is only compiled with
+ *              -DROTARYENCODER_LIBGPIOD, link with -lgpiod then. libgpiod v1 (same
+ *              header name) is not supported.
+ */
+#ifndef _ROTARYENCODERGPIOD_H_
+#define _ROTARYENCODERGPIOD_H_
+#if defined(__linux__) && ! defined(ARDUINO)
+#include <stddef.h>
+#include <stdint.h>
+#include "RotaryEncoder.h"
+
+struct GpioEdge
+{
+  uint64_t ns;            // Kernel timestamp, CLOCK_MONOTONIC
+  unsigned int offset;    // Line offset
+  bool rising;
+};
+
+// Access to the GPIO character device, implemented by LibGpiod and GpiodMock
+class GpiodInterface
+{
+  public:
+    virtual ~GpiodInterface() {}
+    virtual bool request(const char *chip, const unsigned int *offsets, size_t count, unsigned long usDebounce) = 0;
+    virtual bool getValues(uint8_t *values) = 0;            // Levels in the order of the requested offsets
+    virtual int waitEdges(long msTimeout) = 0;              // >0 edges pending, 0 timeout, <0 error
+    virtual int readEdges(GpioEdge *edges, size_t max) = 0; // Number of edges read, <0 error
+    virtual void release() = 0;
+};
+
+#ifdef ROTARYENCODER_LIBGPIOD
+struct gpiod_chip;
+struct gpiod_line_request;
+struct gpiod_edge_event_buffer;
+
+class LibGpiod : public GpiodInterface
+{
+  public:
+    ~LibGpiod() { release(); }
+    bool request(const char *chip, const unsigned int *offsets, size_t count, unsigned long usDebounce) override;
+    bool getValues(uint8_t *values) override;
+    int waitEdges(long msTimeout) override;
+    int readEdges(GpioEdge *edges, size_t max) override;
+    void release() override;
+
+    static const size_t EVENT_BUFFER_SIZE = 64;
+
+  private:
+    gpiod_chip *_chip = nullptr;
+    gpiod_line_request *_request = nullptr;
+    gpiod_edge_event_buffer *_buffer = nullptr;
+    size_t _count = 0;
+};
+#endif
+
+class RotaryEncoderGpiod
+{
+  public:
+    RotaryEncoderGpiod(RotaryEncoder &encoder, GpiodInterface &gpio, const char *chip,
+                       unsigned int lineClk, unsigned int lineData, unsigned int lineButton = NO_LINE);
+    ~RotaryEncoderGpiod() { end(); }
+
+    bool begin(unsigned long usKernelDebounce = 0);  // Request the lines, optionally with kernel debouncing
+    void end();
+    int poll(long msTimeout = 10);                   // Wait for edges and feed them, returns number of edges or <0 on error
+
+    unsigned long getEdgeCount() const { return _edges; }
+    unsigned long getWakeupCount() const { return _wakeups; }
+
+    static const unsigned int NO_LINE = 0xFFFFFFFF;
+    static const size_t EDGE_BATCH_SIZE = 64;
+
+  private:
+    RotaryEncoder &_encoder;
+    GpiodInterface &_gpio;
+    const char *_chip;
+    unsigned int _lines[3];
+    size_t _lineCount;
+    uint8_t _levels[3] = {HIGH, HIGH, HIGH};   // Current levels of CLK, DT, SW
+    GpioEdge _batch[EDGE_BATCH_SIZE];
+    unsigned long _edges = 0;
+    unsigned long _wakeups = 0;
+    bool _requested = false;
+};
+#endif
+#endif
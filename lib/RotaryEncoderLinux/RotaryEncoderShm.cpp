@@ -0,0 +1,95 @@
+/**
+ * Class        RotaryEncoderShm.cpp
+ *
+ * Purpose      Publisher side of the shared memory export, the only writer of the region.
+ *
+ *              Event:     slot.seq = 0 -> write type, us -> slot.seq = n -> head = n
+ *              Snapshot:  snapshotSeq odd -> write snapshot -> snapshotSeq even
+ *              The release stores order the writes for readers in other processes.
+ */
+#include "RotaryEncoderShm.h"
+#if defined(__linux__) && ! defined(ARDUINO)
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <new>
+
+/**
+ * Create the shared memory region with the given name or take over an existing one.
+ * An existing region of this layout is not cleared, readers may have it mapped:
+ * the event numbering continues and the generation tells them about the new publisher.
+ */
+bool RotaryEncoderShmPublisher::begin(const char *name)
+{
+  end();
+  int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+  if (fd < 0) return false;
+  if (ftruncate(fd, sizeof(RotaryShmRegion)) != 0)
+  {
+    close(fd);
+    return false;
+  }
+  void *mem = mmap(nullptr, sizeof(RotaryShmRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) return false;
+
+  _region = (RotaryShmRegion *)mem;
+  bool compatible = _region->magic == ROTARY_SHM_MAGIC && _region->version == ROTARY_SHM_VERSION &&
+                    _region->ringSize == ROTARY_SHM_RING_SIZE;
+  if (! compatible)                                   // New, or of another layout no reader accepts
+  {
+    memset(mem, 0, sizeof(RotaryShmRegion));
+    _region = new (mem) RotaryShmRegion;
+    _region->ringSize = ROTARY_SHM_RING_SIZE;
+    _region->version  = ROTARY_SHM_VERSION;
+  }
+  _head = _region->head.load(std::memory_order_relaxed);    // Readers keep their position
+  uint32_t seq = _region->snapshotSeq.load(std::memory_order_relaxed);
+  _region->snapshotSeq.store(seq + (seq & 1), std::memory_order_relaxed);   // Even, also if the previous publisher died while writing
+  strncpy(_name, name, sizeof(_name) - 1);
+  _region->generation.fetch_add(1, std::memory_order_release);
+  _region->magic = ROTARY_SHM_MAGIC;                  // Readers accept the region from now on
+  return true;
+}
+
+void RotaryEncoderShmPublisher::end(bool unlink)
+{
+  if (_region) munmap(_region, sizeof(RotaryShmRegion));
+  if (unlink && _name[0]) shm_unlink(_name);
+  _region = nullptr;
+}
+
+/**
+ * Move the new events of the encoder into the ring and update the snapshot
+ */
+void RotaryEncoderShmPublisher::publish(RotaryEncoder &encoder)
+{
+  if (! _region) return;
+
+  RotaryEvent event;
+  while (encoder.popEvent(event)) _pushEvent(event);
+
+  uint32_t seq = _region->snapshotSeq.load(std::memory_order_relaxed);
+  _region->snapshotSeq.store(seq + 1, std::memory_order_relaxed);   // odd, being written
+  std::atomic_thread_fence(std::memory_order_release);
+  _region->snapshot.position  = (int32_t)encoder.getPosition();
+  _region->snapshot.events    = _head;
+  _region->snapshot.usUpdated = micros();
+  _region->snapshot.pressed   = encoder.isPressed() ? 1 : 0;
+  _region->snapshotSeq.store(seq + 2, std::memory_order_release);   // even, complete
+}
+
+void RotaryEncoderShmPublisher::_pushEvent(const RotaryEvent &event)
+{
+  uint32_t n = ++_head;
+  if (n == 0) n = _head = 1;                          // seq 0 marks a slot being written
+  RotaryShmSlot &slot = _region->ring[n & (ROTARY_SHM_RING_SIZE - 1)];
+  slot.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.type = event.type;
+  slot.us   = event.us;
+  slot.seq.store(n, std::memory_order_release);
+  _region->head.store(n, std::memory_order_release);
+}
+#endif
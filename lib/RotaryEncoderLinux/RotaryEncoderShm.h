@@ -0,0 +1,36 @@
+/**
+ * Header       RotaryEncoderShm.h
+ *
+ * Purpose      Export of the state and the events of a RotaryEncoder on a Linux
+ *              host in a POSIX shared memory region, for several consumer processes
+ *              (see RotaryEncoderShmReader.h and RotaryEncoderShmLayout.h)
+ *
+ * Remarks      begin() creates the region, e.g. "/rotary0", or takes over the one of a
+ *              previous publisher without disturbing its readers. Call publish() after
+ *              the encoder's loop() or feed(); it moves the events from the encoder's
+ *              event buffer (enableEventBuffer()) into the ring of the region and
+ *              updates the snapshot. Publishing never waits for the readers.
+ */
+#ifndef _ROTARYENCODERSHM_H_
+#define _ROTARYENCODERSHM_H_
+#if defined(__linux__) && ! defined(ARDUINO)
+#include "RotaryEncoder.h"
+#include "RotaryEncoderShmLayout.h"
+
+class RotaryEncoderShmPublisher
+{
+  public:
+    ~RotaryEncoderShmPublisher() { end(); }
+
+    bool begin(const char *name);
+    void end(bool unlink = false);      // unlink removes the name, readers keep their mapping
+    void publish(RotaryEncoder &encoder);
+
+  private:
+    void _pushEvent(const RotaryEvent &event);
+    RotaryShmRegion *_region = nullptr;
+    char _name[64] = "";
+    uint32_t _head = 0;
+};
+#endif
+#endif
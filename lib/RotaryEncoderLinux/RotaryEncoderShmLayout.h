@@ -0,0 +1,71 @@
+/**
+ * Header       RotaryEncoderShmLayout.h
+ *
+ * Purpose      Layout of the POSIX shared memory region in which RotaryEncoderShmPublisher
+ *              exports the state of a RotaryEncoder to other processes and which
+ *              RotaryEncoderShmReader reads. Shared by both sides, no further dependencies.
+ *
+ * Snapshot     Seqlock: the publisher makes seq odd, writes the snapshot and makes
+ *              seq even again. A reader copies the snapshot between two reads of seq
+ *              and retries if seq was odd or has changed.
+ *
+ * Event ring   RING_SIZE slots, event n (counting from 1) goes to slot n % RING_SIZE.
+ *              The slot's seq is 0 while it is written and n when complete. head is the
+ *              number of events written. The publisher never waits for readers; each
+ *              reader keeps its own position and detects overwritten events by seq.
+ *
+ * Generation   Incremented whenever a publisher takes over the region. A new publisher
+ *              continues the event numbering of a region already in use, so the readers
+ *              keep their position in the ring; the snapshot is that of the new
+ *              publisher's encoder.
+ *
+ * Remarks      Counters are 32 bit so that readers can map the region read only, they
+ *              are compared by difference and may wrap.
+ */
+#ifndef _ROTARYENCODERSHMLAYOUT_H_
+#define _ROTARYENCODERSHMLAYOUT_H_
+#include <stdint.h>
+#include <atomic>
+
+const uint32_t ROTARY_SHM_MAGIC   = 0x52454E43;   // "RENC"
+const uint32_t ROTARY_SHM_VERSION = 2;
+const uint32_t ROTARY_SHM_RING_SIZE = 256;        // Must be a power of 2
+
+struct RotaryShmSnapshot
+{
+  int32_t position;         // Steps, clockwise positive
+  uint32_t events;          // Number of events published
+  uint64_t usUpdated;       // micros() of the last update
+  uint8_t pressed;          // 1 while the pushbutton is held
+};
+
+struct RotaryShmEvent
+{
+  uint32_t seq;             // Event number, counting from 1
+  uint8_t type;             // RotaryEventType
+  uint64_t us;              // Timestamp of the event
+};
+
+struct RotaryShmSlot
+{
+  std::atomic<uint32_t> seq;
+  uint8_t type;
+  uint64_t us;
+};
+
+struct RotaryShmRegion
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t ringSize;
+  std::atomic<uint32_t> generation;   // Number of publishers that took over the region
+  std::atomic<uint32_t> snapshotSeq;
+  RotaryShmSnapshot snapshot;
+  std::atomic<uint32_t> head;
+  RotaryShmSlot ring[ROTARY_SHM_RING_SIZE];
+};
+
+#if ATOMIC_INT_LOCK_FREE != 2
+#error "Shared memory export needs lock free 32 bit atomics"
+#endif
+#endif
@@ -0,0 +1,100 @@
+/**
+ * Class        RotaryEncoderShmReader.cpp
+ *
+ * Purpose      Lock free reading of the shared memory region of RotaryEncoderShmPublisher.
+ *
+ *              Snapshot:  seq even -> copy -> seq unchanged, otherwise retry
+ *              Event n:   slot.seq == n -> copy -> slot.seq still n, otherwise the
+ *                         slot was overwritten: continue with the oldest event
+ *                         still in the ring and count the lost ones.
+ */
+#include "RotaryEncoderShmReader.h"
+#if defined(__linux__) && ! defined(ARDUINO)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+bool RotaryEncoderShmReader::begin(const char *name, bool fromStart)
+{
+  end();
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0) return false;
+  void *mem = mmap(nullptr, sizeof(RotaryShmRegion), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) return false;
+
+  _region = (const RotaryShmRegion *)mem;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (_region->magic != ROTARY_SHM_MAGIC || _region->version != ROTARY_SHM_VERSION ||
+      _region->ringSize != ROTARY_SHM_RING_SIZE)
+  {
+    end();
+    return false;
+  }
+  _generation = _region->generation.load(std::memory_order_acquire);
+  _cursor = fromStart ? 0 : _region->head.load(std::memory_order_acquire);
+  _lost = 0;
+  return true;
+}
+
+void RotaryEncoderShmReader::end()
+{
+  if (_region) munmap((void *)_region, sizeof(RotaryShmRegion));
+  _region = nullptr;
+}
+
+uint32_t RotaryEncoderShmReader::getPublisherRestarts() const
+{
+  return _region ? _region->generation.load(std::memory_order_acquire) - _generation : 0;
+}
+
+bool RotaryEncoderShmReader::readSnapshot(RotaryShmSnapshot &snapshot) const
+{
+  if (! _region) return false;
+  for (int retry = 0; retry < SNAPSHOT_RETRIES; retry++)
+  {
+    uint32_t seq = _region->snapshotSeq.load(std::memory_order_acquire);
+    if (seq & 1) continue;                                        // being written
+    snapshot = _region->snapshot;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (_region->snapshotSeq.load(std::memory_order_relaxed) == seq) return true;
+  }
+  return false;
+}
+
+size_t RotaryEncoderShmReader::readEvents(RotaryShmEvent *events, size_t max)
+{
+  if (! _region) return 0;
+  size_t count = 0;
+  uint32_t head = _region->head.load(std::memory_order_acquire);
+
+  while (count < max && (int32_t)(head - _cursor) > 0)
+  {
+    if ((int32_t)(head - _cursor) > (int32_t)ROTARY_SHM_RING_SIZE)  // Fallen behind, skip to oldest
+    {
+      _lost += head - _cursor - ROTARY_SHM_RING_SIZE;
+      _cursor = head - ROTARY_SHM_RING_SIZE;
+    }
+    uint32_t n = _cursor + 1;
+    if (n == 0) n = 1;                                            // seq 0 is skipped by the publisher
+    const RotaryShmSlot &slot = _region->ring[n & (ROTARY_SHM_RING_SIZE - 1)];
+
+    uint32_t seq = slot.seq.load(std::memory_order_acquire);
+    RotaryShmEvent &event = events[count];
+    event.type = slot.type;
+    event.us   = slot.us;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (seq != n || slot.seq.load(std::memory_order_relaxed) != n)   // Overwritten meanwhile
+    {
+      head = _region->head.load(std::memory_order_acquire);
+      if ((int32_t)(head - _cursor) <= (int32_t)ROTARY_SHM_RING_SIZE)  // Not yet complete, try later
+        break;
+      continue;
+    }
+    event.seq = n;
+    _cursor = n;
+    count++;
+  }
+  return count;
+}
+#endif
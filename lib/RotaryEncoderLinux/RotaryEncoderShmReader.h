@@ -0,0 +1,42 @@
+/**
+ * Header       RotaryEncoderShmReader.h
+ *
+ * Purpose      Reader of the state and events exported by RotaryEncoderShmPublisher,
+ *              for consumer processes (UI, logger, control). Any number of readers
+ *              may read the same region, each with its own position in the event ring.
+ *
+ * Remarks      The region is mapped read only, readers never disturb the publisher.
+ *              A reader falling behind by more than ROTARY_SHM_RING_SIZE events loses
+ *              the oldest ones, see getLostEvents(). The reader depends on
+ *              RotaryEncoderShmLayout.h only, not on the RotaryEncoder class. A
+ *              restarted publisher continues the events of the region, readers
+ *              stay mapped and see the restart in getPublisherRestarts().
+ */
+#ifndef _ROTARYENCODERSHMREADER_H_
+#define _ROTARYENCODERSHMREADER_H_
+#if defined(__linux__) && ! defined(ARDUINO)
+#include <stddef.h>
+#include "RotaryEncoderShmLayout.h"
+
+class RotaryEncoderShmReader
+{
+  public:
+    ~RotaryEncoderShmReader() { end(); }
+
+    bool begin(const char *name, bool fromStart = false);  // fromStart=false skips events published before
+    void end();
+    bool readSnapshot(RotaryShmSnapshot &snapshot) const;  // false if the publisher kept writing
+    size_t readEvents(RotaryShmEvent *events, size_t max); // Events since the last call, oldest first
+    uint32_t getLostEvents() const { return _lost; }
+    uint32_t getPublisherRestarts() const;                 // Publishers that took over since begin()
+
+    static const int SNAPSHOT_RETRIES = 100;
+
+  private:
+    const RotaryShmRegion *_region = nullptr;
+    uint32_t _cursor = 0;       // Number of the last event read
+    uint32_t _lost = 0;
+    uint32_t _generation = 0;   // Generation of the region at begin()
+};
+#endif
+#endif
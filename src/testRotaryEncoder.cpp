@@ -16,6 +16,8 @@
  *              - onLongClick()    Reset counter and select debouncing method by cleaning of clock and data signal  
  *              - onDoubleClick()  Show angular position of rotary encoder
  * 
+ *              Sending 'b' over Serial runs the self benchmark of the decoding methods.
+ * 
  * Board        ESP32 DoIt DevKit V1
  *
  * Wiring
@@ -44,6 +46,7 @@
  *              https://www.best-microcontroller-projects.com/rotary-encoder.html           
  */
 #include "RotaryEncoder.h"
+#include "RotaryEncoderBenchmark.h"
 
 const uint8_t PIN_CTRLKNOB_SW  = GPIO_NUM_25;
 const uint8_t PIN_CTRLKNOB_DAT = GPIO_NUM_26;
@@ -99,6 +102,29 @@ void countDown()
   Serial.printf("count = %4d\n", counter);
 }
 
+/**
+ * Callbacks which are called on every step with the pushbutton held (chord mode),
+ * coarse adjustment by 10 counts
+ */
+void countUpCoarse()
+{
+  counter += 10;
+  Serial.printf("count = %4d\n", counter);
+}
+
+void countDownCoarse()
+{
+  counter -= 10;
+  Serial.printf("count = %4d\n", counter);
+}
+
+/**
+ * Print a line of the self benchmark
+ */
+void printLine(const char *line)
+{
+  Serial.println(line);
+}
 
 void setup() 
 {
@@ -110,9 +136,13 @@ void setup()
   ctrlKnob.addOnDoubleClickCB(onDoubleClick);
   ctrlKnob.addOnClockwiseCB(countUp);
   ctrlKnob.addOnCounterClockwiseCB(countDown);
+  ctrlKnob.addOnPressedClockwiseCB(countUpCoarse);
+  ctrlKnob.addOnPressedCounterClockwiseCB(countDownCoarse);
+  ctrlKnob.setChordMode();
 }
 
 void loop() 
 {
   ctrlKnob.loop();
+  if (Serial.available() && Serial.read() == 'b') rotaryEncoderSelfBenchmark(printLine);
 }
\ No newline at end of file
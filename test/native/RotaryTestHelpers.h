@@ -0,0 +1,30 @@
+/**
+ * Header       RotaryTestHelpers.h
+ *
+ * Purpose      Shared by the host tests in test/native: the quadrature levels of a
+ *              clockwise step and a small random generator giving the same
+ *              sequence on every host.
+ *
+ *                 quarter from the detent    0   1   2   3
+ *                 CLK DT                     11  10  00  01
+ *
+ * Remarks      Include as "../RotaryTestHelpers.h". A test seeds the generator
+ *              by setting rngState, e.g. in main() before the tests run.
+ */
+#ifndef _ROTARYTESTHELPERS_H_
+#define _ROTARYTESTHELPERS_H_
+#include <stdint.h>
+
+static const uint8_t CW[4] = {0b10, 0b00, 0b01, 0b11};            // CLK DT after each quarter from the detent
+static const uint8_t QUARTER_LEVELS[4] = {0b11, 0b10, 0b00, 0b01}; // CLK DT at quarter & 3, 0 = detent
+
+inline uint32_t rngState = 1;
+
+inline uint32_t rng(uint32_t range)    // xorshift32
+{
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState % range;
+}
+#endif
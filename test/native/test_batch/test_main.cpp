@@ -0,0 +1,170 @@
+/**
+ * Test         test_batch
+ *
+ * Purpose      Batch callback (addOnEventsCB()): replaySteps() of more steps than
+ *              the event buffer holds delivers all of them in spans, and a benchmark
+ *              of the cost per event of the batch callback against the per step
+ *              callbacks at 300 and 10k steps/s. Only passes that decode something
+ *              are fed (one per quarter step, at the times of the rate), so the
+ *              dispatch is a large part of the time measured per step; the cost
+ *              without decoding is measured by replaySteps().
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "RotaryEncoder.h"
+#include "../RotaryTestHelpers.h"
+
+
+static long position;
+static size_t delivered, calls;
+
+static void onCW() { position++; }
+static void onCCW() { position--; }
+
+static void onEvents(const RotaryEvent *events, uint8_t count)
+{
+  for (uint8_t i = 0; i < count; i++) position += events[i].type == ROTARY_CW ? 1 : -1;
+  delivered += count;
+  calls++;
+}
+
+void setUp(void)
+{
+  position = 0;
+  delivered = calls = 0;
+}
+
+void tearDown(void) {}
+
+void test_replay_dispatches_full_buffers(void)
+{
+  RotaryEncoder encoder;
+  encoder.addOnEventsCB(onEvents);
+  encoder.replaySteps(100);
+  TEST_ASSERT_EQUAL(100, delivered);
+  TEST_ASSERT_EQUAL(100, position);
+  TEST_ASSERT_EQUAL((100 + RotaryEncoder::EVENT_BUFFER_SIZE - 1) / RotaryEncoder::EVENT_BUFFER_SIZE, calls);
+  encoder.replaySteps(-40);
+  TEST_ASSERT_EQUAL(60, position);
+  TEST_ASSERT_EQUAL(0, encoder.getEventOverflows());
+  TEST_ASSERT_EQUAL(0, encoder.availableEvents());
+  TEST_ASSERT_EQUAL(60, encoder.getPosition());
+}
+
+/**
+ * One sample per quarter step, the quarters reversing every 100 steps
+ */
+static std::vector<uint8_t> quarters(size_t steps)
+{
+  std::vector<uint8_t> samples;
+  int quarter = 3, dir = 1;
+  for (size_t q = 1; q <= 4 * steps; q++)
+  {
+    quarter = (quarter + dir + 4) & 3;
+    samples.push_back(CW[quarter]);
+    if (q % 400 == 0) dir = -dir;
+  }
+  return samples;
+}
+
+enum Handler { NONE, PER_STEP, BATCH };
+
+/**
+ * Feed one sample per quarter at the times of stepsPerSecond: only the passes
+ * which decode something, every 4th completes a step. Returns the ns per step.
+ */
+static double run(const std::vector<uint8_t> &samples, unsigned long stepsPerSecond, Handler handler)
+{
+  RotaryEncoder encoder;
+  encoder.setSamplingIntervals(0, 1000);
+  if (handler == PER_STEP)
+  {
+    encoder.addOnClockwiseCB(onCW);
+    encoder.addOnCounterClockwiseCB(onCCW);
+  }
+  if (handler == BATCH) encoder.addOnEventsCB(onEvents);
+  position = 0;
+  unsigned long usQuarter = 250000 / stepsPerSecond;
+  unsigned long us = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint8_t ab : samples) encoder.feed(ab >> 1, ab & 1, HIGH, us += usQuarter);
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  if (handler != NONE) TEST_ASSERT_EQUAL(encoder.getPosition(), position);
+  return ns / (samples.size() / 4);
+}
+
+/**
+ * Cost per step with each handler. The per step callbacks are always called,
+ * empty by default, so without handler and with per step callbacks differ only
+ * by the work of the handler; the batch callback adds the event buffer and its
+ * dispatch, taken as the median of the differences of back to back runs.
+ */
+void test_benchmark_cost_per_event(void)
+{
+  std::vector<uint8_t> samples = quarters(100000);
+  TEST_MESSAGE("steps/s  ns/step: no handler  per step  batch   batch - per step");
+  for (unsigned long rate : {300UL, 10000UL})
+  {
+    const int rounds = 21;
+    double best[3] = {1e30, 1e30, 1e30};
+    std::vector<double> extra;
+    for (int round = 0; round < rounds; round++)
+    {
+      double ns[3];
+      for (int handler = NONE; handler <= BATCH; handler++)
+      {
+        ns[handler] = run(samples, rate, (Handler)handler);
+        if (ns[handler] < best[handler]) best[handler] = ns[handler];
+      }
+      extra.push_back(ns[BATCH] - ns[PER_STEP]);
+    }
+    std::nth_element(extra.begin(), extra.begin() + rounds / 2, extra.end());
+    double batch = extra[rounds / 2];
+    TEST_ASSERT_TRUE(best[NONE] > 0);
+    TEST_ASSERT_TRUE(best[PER_STEP] > 0);
+    TEST_ASSERT_TRUE(batch > 0);    // buffer and dispatch on top of the same handler work
+
+    char message[128];
+    snprintf(message, sizeof(message), "%7lu  %19.2f  %8.2f  %5.2f  %16.2f", rate,
+             best[NONE], best[PER_STEP], best[BATCH], batch);
+    TEST_MESSAGE(message);
+  }
+}
+
+/**
+ * Events without sampling: replaySteps() with either callback, ns per event
+ */
+void test_benchmark_replay_per_event(void)
+{
+  const int16_t steps = 10000;
+  double best[3] = {1e30, 1e30, 1e30};
+  for (int round = 0; round < 7; round++)
+    for (int handler = PER_STEP; handler <= BATCH; handler++)
+    {
+      RotaryEncoder encoder;
+      if (handler == PER_STEP) encoder.addOnClockwiseCB(onCW);
+      else encoder.addOnEventsCB(onEvents);
+      position = 0;
+      auto start = std::chrono::steady_clock::now();
+      for (int n = 0; n < 100; n++) encoder.replaySteps(steps);
+      double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (100.0 * steps);
+      TEST_ASSERT_EQUAL(100L * steps, position);
+      if (ns < best[handler]) best[handler] = ns;
+    }
+  char message[96];
+  snprintf(message, sizeof(message), "replaySteps(): per step callback %.2f ns/event, batch callback %.2f ns/event",
+           best[PER_STEP], best[BATCH]);
+  TEST_MESSAGE(message);
+}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_replay_dispatches_full_buffers);
+  RUN_TEST(test_benchmark_cost_per_event);
+  RUN_TEST(test_benchmark_replay_per_event);
+  return UNITY_END();
+}
@@ -0,0 +1,163 @@
+/**
+ * Test         test_chord
+ *
+ * Purpose      Chord mode (setChordMode()) fed through feed(): steps made with the
+ *              button held go to the pressed events, the release ending a chord
+ *              gives neither click nor long click, a release bouncing back into
+ *              the button within the debounce time still belongs to the chord, and
+ *              a single click pending when a chord starts is still reported once.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include "RotaryEncoder.h"
+#include "../RotaryTestHelpers.h"
+
+static const unsigned long US_POLL = 500;
+
+/**
+ * Encoder fed by the test, counting its events by type
+ */
+struct Knob
+{
+  RotaryEncoder encoder;
+  unsigned long us = 0;
+  uint8_t ab = 0b11;
+  int events[ROTARY_DOUBLE_CLICK + 1] = {};
+
+  Knob()
+  {
+    encoder.setSamplingIntervals(0, 0);
+    encoder.enableEventBuffer();
+    encoder.setChordMode();
+  }
+
+  void hold(uint8_t sw, unsigned long msHold)
+  {
+    for (unsigned long end = us + msHold * 1000; us < end; )
+    {
+      encoder.feed(ab >> 1, ab & 1, sw, us += US_POLL);
+      RotaryEvent event;
+      while (encoder.popEvent(event)) events[event.type]++;
+    }
+  }
+
+  /**
+   * Full steps, clockwise for steps > 0, each quarter held 2 ms
+   */
+  void turn(int steps, uint8_t sw)
+  {
+    int quarter = 3;
+    for (int q = 0; q < 4 * (steps < 0 ? -steps : steps); q++)
+    {
+      quarter = (quarter + (steps > 0 ? 1 : 3)) & 3;
+      ab = CW[quarter];
+      hold(sw, 2);
+    }
+  }
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_steps_routed_by_button(void)
+{
+  Knob knob;
+  knob.hold(HIGH, 10);
+  knob.turn(3, HIGH);
+  knob.hold(LOW, 100);
+  knob.turn(2, LOW);
+  knob.turn(-1, LOW);
+  knob.hold(HIGH, 400);
+  TEST_ASSERT_EQUAL(3, knob.events[ROTARY_CW]);
+  TEST_ASSERT_EQUAL(2, knob.events[ROTARY_PRESSED_CW]);
+  TEST_ASSERT_EQUAL(1, knob.events[ROTARY_PRESSED_CCW]);
+  TEST_ASSERT_EQUAL(0, knob.events[ROTARY_CCW]);
+  TEST_ASSERT_EQUAL(4, knob.encoder.getPosition());
+  TEST_ASSERT_EQUAL(0, knob.events[ROTARY_CLICK]);
+
+  knob.encoder.setChordMode(false);             // Without chord mode the same is a click
+  knob.hold(LOW, 100);
+  knob.turn(1, LOW);
+  knob.hold(HIGH, 400);
+  TEST_ASSERT_EQUAL(4, knob.events[ROTARY_CW]);
+  TEST_ASSERT_EQUAL(1, knob.events[ROTARY_CLICK]);
+}
+
+/**
+ * A chord held longer than msLongClick is no long click
+ */
+void test_long_click_suppressed(void)
+{
+  Knob knob;
+  knob.hold(HIGH, 10);
+  knob.hold(LOW, 100);
+  knob.turn(1, LOW);
+  knob.hold(LOW, 2 * knob.encoder.getConfig().msLongClick);
+  knob.hold(HIGH, 400);
+  TEST_ASSERT_EQUAL(1, knob.events[ROTARY_PRESSED_CW]);
+  TEST_ASSERT_EQUAL(0, knob.events[ROTARY_LONG_CLICK]);
+  TEST_ASSERT_EQUAL(0, knob.events[ROTARY_CLICK]);
+
+  knob.hold(LOW, 2 * knob.encoder.getConfig().msLongClick);   // Without rotation a long click again
+  knob.hold(HIGH, 400);
+  TEST_ASSERT_EQUAL(1, knob.events[ROTARY_LONG_CLICK]);
+}
+
+/**
+ * The release of a chord bounces back to pressed within the debounce time and
+ * stays there longer than the debounce time: still the chord, no click. A press
+ * after the debounce time is a new click.
+ */
+void test_release_bounce_stays_in_chord(void)
+{
+  Knob knob;
+  unsigned long msDebounce = knob.encoder.getDebounce();
+  knob.hold(HIGH, 10);
+  knob.hold(LOW, 100);
+  knob.turn(1, LOW);
+  knob.hold(HIGH, 1);
+  knob.hold(LOW, msDebounce + 20);
+  knob.hold(HIGH, 400);
+  TEST_ASSERT_EQUAL(1, knob.events[ROTARY_PRESSED_CW]);
+  TEST_ASSERT_EQUAL(0, knob.events[ROTARY_CLICK]);
+  TEST_ASSERT_EQUAL(0, knob.events[ROTARY_LONG_CLICK]);
+
+  knob.hold(LOW, 100);
+  knob.turn(1, LOW);
+  knob.hold(HIGH, msDebounce + 10);
+  knob.hold(LOW, 100);
+  knob.hold(HIGH, 400);
+  TEST_ASSERT_EQUAL(2, knob.events[ROTARY_PRESSED_CW]);
+  TEST_ASSERT_EQUAL(1, knob.events[ROTARY_CLICK]);
+}
+
+/**
+ * A click followed by a chord within the double click gap: the click is
+ * reported once as a single click, the chord adds neither a second click
+ * nor a double click
+ */
+void test_pending_click_during_chord(void)
+{
+  Knob knob;
+  knob.hold(HIGH, 10);
+  knob.hold(LOW, 100);
+  knob.hold(HIGH, 50);
+  TEST_ASSERT_EQUAL(0, knob.events[ROTARY_CLICK]);   // Pending, waiting for a second click
+  knob.hold(LOW, 20);
+  knob.turn(2, LOW);
+  knob.hold(HIGH, 400);
+  TEST_ASSERT_EQUAL(2, knob.events[ROTARY_PRESSED_CW]);
+  TEST_ASSERT_EQUAL(1, knob.events[ROTARY_CLICK]);
+  TEST_ASSERT_EQUAL(0, knob.events[ROTARY_DOUBLE_CLICK]);
+  TEST_ASSERT_EQUAL(0, knob.events[ROTARY_LONG_CLICK]);
+}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_steps_routed_by_button);
+  RUN_TEST(test_long_click_suppressed);
+  RUN_TEST(test_release_bounce_stays_in_chord);
+  RUN_TEST(test_pending_click_during_chord);
+  return UNITY_END();
+}
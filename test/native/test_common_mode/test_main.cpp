@@ -0,0 +1,175 @@
+/**
+ * Test         test_common_mode
+ *
+ * Purpose      Rejection of common mode glitches: 8 encoders per port turned at
+ *              random (up to 2 at once, each state lasting 3 samples) with glitches
+ *              flipping 6 of the 16 lines at once. A glitch and the return from it
+ *              mask 2 snapshots, so glitches are at least 3 samples apart for every
+ *              state to pass at least once. Decoded standalone
+ *              through RotaryCommonModeFilter and through RotaryEncoderMatrix with
+ *              enableCommonModeFilter(): unfiltered the glitches make encoders
+ *              miscount, filtered every encoder keeps the true position.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include "RotaryEncoderMatrix.h"
+#include "../RotaryTestHelpers.h"
+
+static const int COLS = 8;
+static const uint8_t clkPins[COLS]  = {1, 3, 5, 7, 9, 11, 13, 15};
+static const uint8_t dataPins[COLS] = {0, 2, 4, 6, 8, 10, 12, 14};
+static const uint8_t rowPins[2] = {30, 31};
+static const uint32_t LINES = 0xFFFF;
+
+/**
+ * Simulated encoders on the 16 lines of one port
+ */
+struct Port
+{
+  int quarter[COLS] = {};
+  int hold[COLS] = {};          // samples the current state has still to last
+  long steps[COLS] = {};        // true position
+  int sinceGlitch = 3;
+  unsigned long glitches = 0;
+
+  void move(int e)
+  {
+    if (hold[e]) return;
+    int dir = e & 1 ? 1 : -1;
+    hold[e] = 3;
+    quarter[e] = (quarter[e] + dir + 4) & 3;
+    if (quarter[e] == 0) steps[e] += dir;
+  }
+
+  /**
+   * Levels of the next sample, with a glitch in about 1 % of the samples
+   */
+  uint32_t sample()
+  {
+    for (int e = 0; e < COLS; e++) if (hold[e]) hold[e]--;
+    if (rng(3) == 0) move(rng(COLS));
+    if (rng(5) == 0) move(rng(COLS));                   // a second encoder at once
+    uint32_t port = ~LINES;
+    for (int e = 0; e < COLS; e++) port |= (uint32_t)QUARTER_LEVELS[quarter[e]] << dataPins[e];
+    if (++sinceGlitch > 2 && rng(100) == 0)             // isolated, 2 clean samples in between
+    {
+      uint32_t glitch = 0;
+      while (__builtin_popcount(glitch) < 6) glitch |= (uint32_t)1 << rng(16);
+      port ^= glitch;
+      sinceGlitch = 0;
+      glitches++;
+    }
+    return port;
+  }
+};
+
+static const unsigned long SAMPLES = 200000;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+/**
+ * Encoders fed from the port, through the filter if enabled; returns the
+ * number of encoders off their true position
+ */
+static int standalone(bool filtered, uint32_t *rejections, unsigned long *glitches)
+{
+  RotaryEncoder encoders[COLS];
+  for (RotaryEncoder &encoder : encoders) encoder.setSamplingIntervals(0, 0);
+  RotaryCommonModeFilter filter(LINES, 3);
+  filter.begin(0xFFFFFFFF);
+  Port port;
+  unsigned long us = 0;
+  for (unsigned long n = 0; n < SAMPLES; n++)
+  {
+    uint32_t levels = port.sample();
+    if (filtered) levels = filter.filter(levels);
+    us += 10;
+    for (int e = 0; e < COLS; e++) encoders[e].feed((levels >> clkPins[e]) & 1, (levels >> dataPins[e]) & 1, HIGH, us);
+  }
+  int wrong = 0;
+  for (int e = 0; e < COLS; e++) if (encoders[e].getPosition() != port.steps[e]) wrong++;
+  *rejections = filter.getRejections();
+  *glitches = port.glitches;
+  return wrong;
+}
+
+void test_standalone_filter(void)
+{
+  uint32_t rejections;
+  unsigned long glitches;
+  int wrongUnfiltered = standalone(false, &rejections, &glitches);
+  int wrongFiltered = standalone(true, &rejections, &glitches);
+  TEST_ASSERT_GREATER_THAN(0, wrongUnfiltered);
+  TEST_ASSERT_EQUAL(0, wrongFiltered);
+  TEST_ASSERT_GREATER_OR_EQUAL(glitches, rejections);
+
+  char message[128];
+  snprintf(message, sizeof(message), "standalone: %lu glitches, %u snapshots masked, encoders wrong %d unfiltered, %d filtered",
+           glitches, rejections, wrongUnfiltered, wrongFiltered);
+  TEST_MESSAGE(message);
+}
+
+/**
+ * Port functions of the matrix: the simulated port of the row driven low
+ */
+static Port *rows;
+static int activeRow = -1;
+
+static uint32_t readRow()
+{
+  return activeRow < 0 ? 0xFFFFFFFF : rows[activeRow].sample();
+}
+
+static void driveRow(uint8_t pin, uint8_t level)
+{
+  for (int r = 0; r < 2; r++)
+    if (rowPins[r] == pin) activeRow = level == LOW ? r : -1;
+}
+
+static int matrix(bool filtered, uint32_t *rejections, unsigned long *glitches)
+{
+  RotaryEncoder encoders[2 * COLS];
+  for (RotaryEncoder &encoder : encoders) encoder.setSamplingIntervals(0, 0);
+  Port ports[2];
+  rows = ports;
+  RotaryEncoderMatrix matrix(rowPins, 2, clkPins, dataPins, COLS, encoders);
+  matrix.setPortFunctions(readRow, driveRow);
+  matrix.setSettleTime(0);
+  matrix.begin();
+  matrix.enableCommonModeFilter(filtered, 3);
+  for (unsigned long n = 0; n < SAMPLES; n++) matrix.loop();
+
+  int wrong = 0;
+  for (int r = 0; r < 2; r++)
+    for (int e = 0; e < COLS; e++) if (encoders[r * COLS + e].getPosition() != ports[r].steps[e]) wrong++;
+  *rejections = matrix.getCommonModeRejections();
+  *glitches = ports[0].glitches + ports[1].glitches;
+  return wrong;
+}
+
+void test_matrix_filter(void)
+{
+  uint32_t rejections;
+  unsigned long glitches;
+  int wrongUnfiltered = matrix(false, &rejections, &glitches);
+  TEST_ASSERT_EQUAL(0, rejections);
+  int wrongFiltered = matrix(true, &rejections, &glitches);
+  TEST_ASSERT_GREATER_THAN(0, wrongUnfiltered);
+  TEST_ASSERT_EQUAL(0, wrongFiltered);
+  TEST_ASSERT_GREATER_OR_EQUAL(glitches, rejections);
+
+  char message[128];
+  snprintf(message, sizeof(message), "matrix 2 x 8: %lu glitches, %u snapshots masked, encoders wrong %d unfiltered, %d filtered",
+           glitches, rejections, wrongUnfiltered, wrongFiltered);
+  TEST_MESSAGE(message);
+}
+
+int main(int, char **)
+{
+  rngState = 9;
+  UNITY_BEGIN();
+  RUN_TEST(test_standalone_filter);
+  RUN_TEST(test_matrix_filter);
+  return UNITY_END();
+}
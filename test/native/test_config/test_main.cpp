@@ -0,0 +1,136 @@
+/**
+ * Test         test_config
+ *
+ * Purpose      Reconfiguration by publishConfig() while another thread feeds the
+ *              encoder: the debouncing method is switched all the time during
+ *              rotation, yet no step may be lost or added and no torn
+ *              configuration may be adopted.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include "RotaryEncoder.h"
+#include "../RotaryTestHelpers.h"
+
+
+static long cwCount, ccwCount;
+
+void setUp(void)
+{
+  cwCount = ccwCount = 0;
+}
+
+void tearDown(void) {}
+
+/**
+ * Feed steps of a back and forth motion, 3 passes per quarter and bouncing
+ * at the first edge of every step if bounce is set. Returns the expected position.
+ */
+static long turn(RotaryEncoder &encoder, long steps, bool bounce, unsigned long &us, unsigned long &switches)
+{
+  long expected = 0;
+  int quarter = 3;
+  bool byTable = encoder.getConfig().debouncingByTable;
+  for (long s = 0; s < steps; s++)
+  {
+    int dir = (s / 1000) % 3 == 2 ? -1 : 1;
+    for (int q = 0; q < 4; q++)
+    {
+      int prev = quarter;
+      quarter = (quarter + dir + 4) & 3;
+      for (int pass = 0; pass < 3; pass++)
+      {
+        uint8_t ab = CW[bounce && q == 0 && pass == 1 ? prev : quarter];
+        encoder.feed(ab >> 1, ab & 1, HIGH, us += 10);
+        const RotaryEncoderConfig &config = encoder.getConfig();
+        TEST_ASSERT_EQUAL(config.msLongClick - 50, config.msDoubleClickGap);  // not torn
+        if (config.debouncingByTable != byTable)
+        {
+          byTable = config.debouncingByTable;
+          switches++;
+        }
+      }
+    }
+    expected += dir;
+  }
+  return expected;
+}
+
+static void switchWhileTurning(bool bounce)
+{
+  RotaryEncoder encoder;
+  encoder.addOnClockwiseCB([]() { cwCount++; });
+  encoder.addOnCounterClockwiseCB([]() { ccwCount++; });
+  RotaryEncoderConfig config;
+  config.usButtonInterval = 0;
+  encoder.publishConfig(config);
+  unsigned long us = 1000, switches = 0;
+  encoder.feed(HIGH, HIGH, HIGH, us);                 // at rest in the detent
+
+  std::atomic<bool> done{false};
+  std::thread writer([&]()
+  {
+    for (unsigned long n = 0; ! done.load(std::memory_order_relaxed); n++)
+    {
+      RotaryEncoderConfig next = encoder.getPublishedConfig();
+      next.debouncingByTable = ! next.debouncingByTable;
+      next.msLongClick = 300 + n % 1000;
+      next.msDoubleClickGap = next.msLongClick - 50;
+      encoder.publishConfig(next);
+      std::this_thread::sleep_for(std::chrono::microseconds(20));
+    }
+  });
+
+  long expected = turn(encoder, 300000, bounce, us, switches);
+  done = true;
+  writer.join();
+
+  char message[64];
+  snprintf(message, sizeof(message), "%lu method switches adopted", switches);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_GREATER_THAN(100, switches);
+  TEST_ASSERT_EQUAL(expected, encoder.getPosition());
+  TEST_ASSERT_EQUAL(expected, cwCount - ccwCount);
+  TEST_ASSERT_EQUAL(300000, cwCount + ccwCount);
+}
+
+void test_switch_while_turning_clean(void)
+{
+  switchWhileTurning(false);
+}
+
+void test_switch_while_turning_bouncing(void)
+{
+  switchWhileTurning(true);
+}
+
+/**
+ * A method switch published in the middle of a step waits for the detent
+ */
+void test_switch_waits_for_detent(void)
+{
+  RotaryEncoder encoder;
+  unsigned long us = 0;
+  encoder.setSamplingIntervals(0, 0);
+  encoder.feed(HIGH, HIGH, HIGH, us += 10);
+  encoder.feed(1, 0, HIGH, us += 10);
+  encoder.feed(0, 0, HIGH, us += 10);
+  encoder.setDebouncingRotEncByTable(false);
+  encoder.feed(0, 1, HIGH, us += 10);
+  TEST_ASSERT_TRUE(encoder.getConfig().debouncingByTable);
+  encoder.feed(1, 1, HIGH, us += 10);
+  TEST_ASSERT_EQUAL(1, encoder.getPosition());
+  encoder.feed(1, 1, HIGH, us += 10);
+  TEST_ASSERT_FALSE(encoder.getConfig().debouncingByTable);
+  TEST_ASSERT_EQUAL(1, encoder.getPosition());
+}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_switch_while_turning_clean);
+  RUN_TEST(test_switch_while_turning_bouncing);
+  RUN_TEST(test_switch_waits_for_detent);
+  return UNITY_END();
+}
@@ -0,0 +1,136 @@
+/**
+ * Test         test_debounce
+ *
+ * Purpose      Auto debounce of the pushbutton on synthetic bounce distributions
+ *              (good, typical and worn switches): the tuned debounce time, the
+ *              click latency and the shortest press still counted as a click,
+ *              against the fixed 50 ms. Edges are reported without delay, so the
+ *              latency stays release + double click gap; the debounce time is the
+ *              minimum press length.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include "RotaryEncoder.h"
+#include "../RotaryTestHelpers.h"
+
+static const unsigned long US_POLL = 50;
+
+struct Bounce
+{
+  const char *name;
+  unsigned long usMin, usMax;    // duration of a bounce burst
+};
+
+static unsigned long us;
+
+static void hold(RotaryEncoder &encoder, uint8_t sw, unsigned long usHold)
+{
+  for (unsigned long end = us + usHold; us < end; ) encoder.feed(HIGH, HIGH, sw, us += US_POLL);
+}
+
+/**
+ * Change the button to level with a bounce burst of the distribution
+ */
+static void edge(RotaryEncoder &encoder, uint8_t level, const Bounce &bounce)
+{
+  unsigned long usBurst = bounce.usMin + rng(bounce.usMax - bounce.usMin + 1);
+  unsigned long usEnd = us + usBurst;
+  uint8_t sw = level;
+  while (us + 2 * US_POLL < usEnd)
+  {
+    hold(encoder, sw, US_POLL * (1 + rng(3)));
+    sw ^= 1;
+  }
+  hold(encoder, level, usEnd > us ? usEnd - us : 0);
+}
+
+/**
+ * Click with bouncing edges, returns the latency from the first release edge
+ * to the click event, 0 if no click was reported
+ */
+static unsigned long click(RotaryEncoder &encoder, const Bounce &bounce, unsigned long msPress)
+{
+  RotaryEvent event;
+  while (encoder.popEvent(event)) {}
+  edge(encoder, LOW, bounce);
+  hold(encoder, LOW, msPress * 1000);
+  unsigned long usRelease = us;
+  edge(encoder, HIGH, bounce);
+  hold(encoder, HIGH, 400000);
+  while (encoder.popEvent(event))
+    if (event.type == ROTARY_CLICK) return event.us - usRelease;
+  return 0;
+}
+
+/**
+ * Shortest clean press (no bouncing) counted as a click, in ms
+ */
+static unsigned long shortestClick(RotaryEncoder &encoder)
+{
+  static const Bounce clean = {"clean", 0, 0};
+  for (unsigned long ms = 1; ms <= 100; ms++)
+    if (click(encoder, clean, ms)) return ms;
+  return 0;
+}
+
+void setUp(void)
+{
+  us = 0;
+}
+
+void tearDown(void) {}
+
+void test_latency_and_shortest_press(void)
+{
+  static const Bounce bounces[] = {{"good", 200, 1000}, {"typical", 1000, 5000}, {"worn", 5000, 15000}};
+  TEST_MESSAGE("switch    debounce ms  click latency ms  shortest click ms   (fixed 50 ms: latency / shortest)");
+  for (const Bounce &bounce : bounces)
+  {
+    RotaryEncoder fixed, tuned;
+    fixed.setSamplingIntervals(0, 0);
+    tuned.setSamplingIntervals(0, 0);
+    fixed.enableEventBuffer();
+    tuned.enableEventBuffer();
+    tuned.enableAutoDebounce();
+    TEST_ASSERT_TRUE(tuned.getPublishedConfig().autoDebounce);   // taken over in the next pass
+
+    unsigned long latencyFixed = 0, latencyTuned = 0;
+    for (int n = 0; n < 300; n++)                  // presses of 60 to 250 ms
+    {
+      uint32_t state = rngState;
+      unsigned long msPress = 60 + rng(190);
+      unsigned long usStart = us;
+      latencyFixed = click(fixed, bounce, msPress);
+      TEST_ASSERT_GREATER_THAN(0, latencyFixed);
+      rngState = state;                            // same bouncing for both
+      rng(190);
+      us = usStart;
+      latencyTuned = click(tuned, bounce, msPress);
+      TEST_ASSERT_EQUAL(latencyFixed, latencyTuned);
+    }
+
+    unsigned long msDebounce = tuned.getDebounce();
+    TEST_ASSERT_LESS_OR_EQUAL(50, msDebounce);
+    TEST_ASSERT_GREATER_THAN(bounce.usMax / 1000, msDebounce);   // safe margin above the bursts
+    unsigned long usNow = us;
+    tuned.enableAutoDebounce(false);               // keep the tuned time, short taps would look like bursts
+    unsigned long shortestTuned = shortestClick(tuned);
+    us = usNow;
+    unsigned long shortestFixed = shortestClick(fixed);
+    TEST_ASSERT_EQUAL(50, shortestFixed);
+    TEST_ASSERT_INT_WITHIN(1, msDebounce, shortestTuned);
+
+    char message[128];
+    snprintf(message, sizeof(message), "%-9s %11lu  %16.1f  %17lu   (%.1f / %lu)", bounce.name, msDebounce,
+             latencyTuned / 1000.0, shortestTuned, latencyFixed / 1000.0, shortestFixed);
+    TEST_MESSAGE(message);
+  }
+}
+
+int main(int, char **)
+{
+  rngState = 11;
+  UNITY_BEGIN();
+  RUN_TEST(test_latency_and_shortest_press);
+  return UNITY_END();
+}
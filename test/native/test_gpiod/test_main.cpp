@@ -0,0 +1,173 @@
+/**
+ * Test         test_gpiod
+ *
+ * Purpose      RotaryEncoderGpiod fed by GpiodMock: steps and event times from the
+ *              edge timestamps, button timing across the wrap of the fed
+ *              microseconds, and a benchmark of the edges processed per second and
+ *              the wake ups per step at several step rates.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <limits.h>
+#include <chrono>
+#include <vector>
+#include "GpiodMock.h"
+#include "../RotaryTestHelpers.h"
+
+static const unsigned int LINE_CLK = 17, LINE_DATA = 18, LINE_BUTTON = 27;
+
+/**
+ * Edges of steps (CW positive) starting at ns, one quarter every nsQuarter
+ */
+static std::vector<GpioEdge> rotation(uint64_t ns, long steps, uint64_t nsQuarter)
+{
+  std::vector<GpioEdge> edges;
+  uint8_t clk = 1, data = 1;
+  long count = steps < 0 ? -steps : steps;
+  for (long s = 0; s < count; s++)
+    for (int q = 0; q < 4; q++)
+    {
+      uint8_t ab = CW[steps > 0 ? q : (2 - q) & 3];
+      ns += nsQuarter;
+      if ((ab >> 1) != clk) edges.push_back({ns, LINE_CLK, (ab >> 1) == 1});
+      if ((ab & 1) != data) edges.push_back({ns, LINE_DATA, (ab & 1) == 1});
+      clk = ab >> 1;
+      data = ab & 1;
+    }
+  return edges;
+}
+
+static uint64_t nsStart()                // a little after the feed of begin()
+{
+  return (uint64_t)micros() * 1000 + 1000000;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_steps_at_edge_times(void)
+{
+  RotaryEncoder encoder;
+  encoder.enableEventBuffer();
+  GpiodMock mock;
+  RotaryEncoderGpiod gpiod(encoder, mock, "/dev/gpiochip0", LINE_CLK, LINE_DATA, LINE_BUTTON);
+  TEST_ASSERT_TRUE(gpiod.begin());
+
+  std::vector<GpioEdge> edges = rotation(nsStart(), 10, 4000000);
+  std::vector<GpioEdge> back = rotation(edges.back().ns, -4, 2000000);
+  edges.insert(edges.end(), back.begin(), back.end());
+  for (const GpioEdge &edge : edges) TEST_ASSERT_TRUE(mock.addEdge(edge.offset, edge.rising, edge.ns));
+  while (mock.pending()) gpiod.poll(0);
+
+  TEST_ASSERT_EQUAL(6, encoder.getPosition());
+  TEST_ASSERT_EQUAL(edges.size(), gpiod.getEdgeCount());
+  RotaryEvent event;
+  for (int s = 0; s < 14; s++)                   // step completed by the 4th edge of each step
+  {
+    TEST_ASSERT_TRUE(encoder.popEvent(event));
+    TEST_ASSERT_EQUAL(s < 10 ? ROTARY_CW : ROTARY_CCW, event.type);
+    TEST_ASSERT_EQUAL(edges[4 * s + 3].ns / 1000, event.us);
+  }
+}
+
+/**
+ * begin() samples every edge: a button edge 200 us after the previous
+ * button sample is decoded at its own time, not in the next 1 ms slot
+ */
+void test_begin_samples_every_edge(void)
+{
+  RotaryEncoder encoder;
+  encoder.enableEventBuffer();
+  encoder.setSamplingIntervals(0, 1000);
+  GpiodMock mock;
+  RotaryEncoderGpiod gpiod(encoder, mock, "/dev/gpiochip0", LINE_CLK, LINE_DATA, LINE_BUTTON);
+  TEST_ASSERT_TRUE(gpiod.begin());
+  TEST_ASSERT_EQUAL(0, encoder.getConfig().usRotaryInterval);
+  TEST_ASSERT_EQUAL(0, encoder.getConfig().usButtonInterval);
+
+  uint64_t ns = nsStart();
+  mock.addEdge(LINE_BUTTON, false, ns);                     // press
+  mock.addEdge(LINE_CLK, false, ns + 400000000);            // sampled with the button
+  mock.addEdge(LINE_BUTTON, true, ns + 400200000);          // release after 400.2 ms
+  while (mock.pending()) gpiod.poll(0);
+  RotaryEvent event;
+  TEST_ASSERT_TRUE(encoder.popEvent(event));
+  TEST_ASSERT_EQUAL(ROTARY_LONG_CLICK, event.type);
+  TEST_ASSERT_EQUAL((ns + 400200000) / 1000, event.us);
+}
+
+/**
+ * A click whose press and release lie on both sides of the wrap of the fed
+ * microseconds is a click, reported at the click deadline
+ */
+void test_click_across_wrap(void)
+{
+  RotaryEncoder encoder;
+  encoder.enableEventBuffer();
+  encoder.setSamplingIntervals(0, 0);
+  unsigned long us = ULONG_MAX - 60000;
+  encoder.feed(HIGH, HIGH, HIGH, us);
+  encoder.feed(HIGH, HIGH, LOW, us += 10000);    // press
+  encoder.feed(HIGH, HIGH, LOW, us += 50000);
+  TEST_ASSERT_LESS_THAN(60000UL, us + 50000);    // wrapped before the release
+  encoder.feed(HIGH, HIGH, HIGH, us += 100000);  // release after 150 ms, wrapped
+  unsigned long usRelease = us;
+
+  unsigned long usDeadline;
+  TEST_ASSERT_TRUE(encoder.getClickDeadline(usDeadline));
+  TEST_ASSERT_UINT_WITHIN(1000, usRelease + 251000, usDeadline);
+  encoder.feed(HIGH, HIGH, HIGH, usDeadline - 1);
+  TEST_ASSERT_EQUAL(0, encoder.availableEvents());
+  encoder.feed(HIGH, HIGH, HIGH, usDeadline);
+  RotaryEvent event;
+  TEST_ASSERT_TRUE(encoder.popEvent(event));
+  TEST_ASSERT_EQUAL(ROTARY_CLICK, event.type);
+  TEST_ASSERT_EQUAL(usDeadline, event.us);
+}
+
+/**
+ * Edges arrive at the step rate; every wake up reads what arrived until the
+ * process runs, usLatency after the first pending edge
+ */
+static void measure(unsigned long stepsPerSecond, unsigned long usLatency)
+{
+  RotaryEncoder encoder;
+  GpiodMock mock;
+  RotaryEncoderGpiod gpiod(encoder, mock, "/dev/gpiochip0", LINE_CLK, LINE_DATA, LINE_BUTTON);
+  gpiod.begin();
+  long steps = 20000;
+  std::vector<GpioEdge> edges = rotation(nsStart(), steps, 250000000ULL / stepsPerSecond);
+
+  double seconds = 0;
+  for (size_t i = 0; i < edges.size(); )
+  {
+    uint64_t nsWake = edges[i].ns + usLatency * 1000ULL;
+    for ( ; i < edges.size() && edges[i].ns <= nsWake; i++) mock.addEdge(edges[i].offset, edges[i].rising, edges[i].ns);
+    auto start = std::chrono::steady_clock::now();
+    while (mock.pending()) gpiod.poll(0);
+    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  TEST_ASSERT_EQUAL(steps, encoder.getPosition());
+
+  char message[128];
+  snprintf(message, sizeof(message), "%6lu steps/s, latency %4lu us: %5.2f wake ups/step, %6.1f M edges/s",
+           stepsPerSecond, usLatency, (double)gpiod.getWakeupCount() / steps, gpiod.getEdgeCount() / seconds / 1e6);
+  TEST_MESSAGE(message);
+}
+
+void test_benchmark_edges_and_wakeups(void)
+{
+  static const unsigned long rates[] = {10, 100, 1000, 10000};
+  for (unsigned long latency : {100UL, 1000UL})
+    for (unsigned long rate : rates) measure(rate, latency);
+}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_steps_at_edge_times);
+  RUN_TEST(test_begin_samples_every_edge);
+  RUN_TEST(test_click_across_wrap);
+  RUN_TEST(test_benchmark_edges_and_wakeups);
+  return UNITY_END();
+}
@@ -0,0 +1,126 @@
+/**
+ * Test         test_matrix
+ *
+ * Purpose      RotaryEncoderMatrix on RotaryMatrixSim up to the largest matrix of
+ *              16 x 8 encoders, with a RotaryEncoder or a light RotaryMatrixCell per
+ *              encoder, and the maximum step rate per encoder depending on the
+ *              matrix size: one quarter step per scan is decoded, so the rate is
+ *              1 / (4 * scan period). The scan is timed on this host with the
+ *              simulated port and without settle time; the rate reported adds the
+ *              default settle time of every row (rows * getSettleTime()), which
+ *              a real matrix waits in each scan.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include <memory>
+#include "RotaryMatrixSim.h"
+
+static uint8_t rowPins[RotaryEncoderMatrix::MAX_ROWS];
+static uint8_t clkPins[RotaryEncoderMatrix::MAX_COLS];
+static uint8_t dataPins[RotaryEncoderMatrix::MAX_COLS];
+
+void setUp(void)
+{
+  for (uint8_t i = 0; i < RotaryEncoderMatrix::MAX_ROWS; i++) rowPins[i] = 32 + i;  // drive only, any id
+  for (uint8_t i = 0; i < RotaryEncoderMatrix::MAX_COLS; i++)
+  {
+    clkPins[i]  = i;                                  // sense lines within one 32 bit port
+    dataPins[i] = 16 + i;
+  }
+}
+
+void tearDown(void) {}
+
+/**
+ * Turn every encoder by quartersPerScan in each of scans scans (every third one
+ * counterclockwise) and check the positions, returns the time per scan in ns.
+ * Beyond the rate limit (decodable false) no step may be counted.
+ */
+static double scanTurning(uint8_t rows, uint8_t cols, int quartersPerScan, unsigned long scans, bool decodable,
+                          bool cells = false)
+{
+  std::unique_ptr<RotaryEncoder[]> encoders(cells ? nullptr : new RotaryEncoder[rows * cols]);
+  std::unique_ptr<RotaryMatrixCell[]> light(cells ? new RotaryMatrixCell[rows * cols] : nullptr);
+  RotaryEncoderMatrix matrix = cells ? RotaryEncoderMatrix(rowPins, rows, clkPins, dataPins, cols, light.get())
+                                     : RotaryEncoderMatrix(rowPins, rows, clkPins, dataPins, cols, encoders.get());
+  RotaryMatrixSim sim(rowPins, rows, clkPins, dataPins, cols);
+  sim.attach(matrix);
+  matrix.setSettleTime(0);
+  matrix.begin();
+  matrix.loop();
+  uint16_t count = rows * cols;
+
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned long n = 0; n < scans; n++)
+  {
+    for (uint16_t e = 0; e < count; e++) sim.turn(e, e % 3 == 2 ? -quartersPerScan : quartersPerScan);
+    matrix.loop();
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / scans;
+
+  for (uint16_t e = 0; e < count; e++)
+  {
+    long expected = sim.getQuarters(e) / 4;
+    TEST_ASSERT_EQUAL((e % 3 == 2 ? -1 : 1) * (long)(scans * quartersPerScan / 4), expected);
+    TEST_ASSERT_EQUAL(decodable ? expected : 0, cells ? light[e].position : encoders[e].getPosition());
+  }
+  return ns;
+}
+
+void test_largest_matrix(void)
+{
+  scanTurning(RotaryEncoderMatrix::MAX_ROWS, RotaryEncoderMatrix::MAX_COLS, 1, 4000, true);
+  scanTurning(RotaryEncoderMatrix::MAX_ROWS, RotaryEncoderMatrix::MAX_COLS, 1, 4000, true, true);
+}
+
+void test_out_of_range_ignored(void)
+{
+  RotaryMatrixSim sim(rowPins, 20, clkPins, dataPins, 20);   // clamped to 16 x 8
+  sim.turn(127, 4);
+  TEST_ASSERT_EQUAL(4, sim.getQuarters(127));
+  RotaryMatrixSim small(rowPins, 2, clkPins, dataPins, 2);
+  small.turn(4, 4);
+  TEST_ASSERT_EQUAL(0, small.getQuarters(4));
+}
+
+/**
+ * Two quarters per scan skip a state, the decoder cannot follow any more
+ */
+void test_beyond_rate_limit(void)
+{
+  scanTurning(2, 2, 2, 400, false);
+  scanTurning(2, 2, 2, 400, false, true);
+}
+
+void test_benchmark_step_rate_vs_size(void)
+{
+  static const uint8_t sizes[][2] = {{1, 1}, {1, 4}, {2, 4}, {4, 4}, {4, 8}, {8, 8}, {16, 8}};
+  unsigned int usSettle = RotaryEncoderMatrix(rowPins, 1, clkPins, dataPins, 1, (RotaryEncoder *)nullptr).getSettleTime();
+  char message[128];
+  snprintf(message, sizeof(message), "bytes per encoder: RotaryEncoder %u, RotaryMatrixCell %u",
+           (unsigned)sizeof(RotaryEncoder), (unsigned)sizeof(RotaryMatrixCell));
+  TEST_MESSAGE(message);
+  TEST_MESSAGE("            RotaryEncoder                       RotaryMatrixCell");
+  TEST_MESSAGE("rows cols  ns/scan host  + settle  steps/s   ns/scan host  + settle  steps/s  (max per encoder)");
+  for (const uint8_t *size : sizes)
+  {
+    unsigned long scans = 200000 / (size[0] * size[1]) * 4;
+    double ns = scanTurning(size[0], size[1], 1, scans, true);
+    double nsCells = scanTurning(size[0], size[1], 1, scans, true, true);
+    double nsSettle = size[0] * usSettle * 1000.0;
+    snprintf(message, sizeof(message), "%4u %4u %13.0f  %8.0f  %7.0f  %13.0f  %8.0f  %7.0f", size[0], size[1],
+             ns, ns + nsSettle, 1e9 / (4 * (ns + nsSettle)), nsCells, nsCells + nsSettle, 1e9 / (4 * (nsCells + nsSettle)));
+    TEST_MESSAGE(message);
+  }
+}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_largest_matrix);
+  RUN_TEST(test_out_of_range_ignored);
+  RUN_TEST(test_beyond_rate_limit);
+  RUN_TEST(test_benchmark_step_rate_vs_size);
+  return UNITY_END();
+}
@@ -0,0 +1,191 @@
+/**
+ * Test         test_merger
+ *
+ * Purpose      RotaryEventMerger on 8 to 64 encoders turned at random times: the
+ *              merged stream is complete and in chronological order, and a
+ *              benchmark of the merge throughput (events/s) against a linear scan
+ *              of the oldest event of every encoder.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include "RotaryEventMerger.h"
+#include "../RotaryTestHelpers.h"
+
+static const unsigned long US_ROUND = 10000;              // time span of the steps buffered per round
+static const int STEPS_PER_ROUND = 12;                    // per encoder, fits the event buffer
+
+struct Encoders
+{
+  std::unique_ptr<RotaryEncoder[]> encoders;
+  RotaryEncoder *pointers[RotaryEventMerger::MAX_ENCODERS];
+  uint8_t count;
+
+  explicit Encoders(uint8_t n) : encoders(new RotaryEncoder[n]), count(n)
+  {
+    for (uint8_t e = 0; e < n; e++)
+    {
+      pointers[e] = &encoders[e];
+      encoders[e].setSamplingIntervals(0, 0);
+      encoders[e].enableEventBuffer();
+      encoders[e].feed(HIGH, HIGH, HIGH, 1);
+    }
+  }
+
+  /**
+   * Steps of every encoder at random times within the round starting at usRound
+   */
+  void turn(unsigned long usRound)
+  {
+    for (uint8_t e = 0; e < count; e++)
+    {
+      unsigned long us = usRound;
+      for (int s = 0; s < STEPS_PER_ROUND; s++)
+      {
+        us += 4 + rng(US_ROUND / STEPS_PER_ROUND - 4);
+        for (int q = 0; q < 4; q++)
+        {
+          uint8_t ab = CW[q];
+          encoders[e].feed(ab >> 1, ab & 1, HIGH, us - 3 + q);
+        }
+      }
+    }
+  }
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+/**
+ * Oldest event by comparing the heads of all encoders, as reference
+ */
+static bool nextByScan(Encoders &set, MergedRotaryEvent &event)
+{
+  RotaryEvent head, oldest;
+  int found = -1;
+  for (uint8_t e = 0; e < set.count; e++)
+    if (set.encoders[e].peekEvent(head) && (found < 0 || (long)(head.us - oldest.us) < 0))
+    {
+      oldest = head;
+      found = e;
+    }
+  if (found < 0) return false;
+  set.encoders[found].popEvent(oldest);
+  event.us = oldest.us;
+  event.type = oldest.type;
+  event.encoder = found;
+  return true;
+}
+
+/**
+ * Merge rounds of events, returns the ns per merged event
+ */
+static double merge(uint8_t count, int rounds, bool byHeap)
+{
+  Encoders set(count);
+  RotaryEventMerger merger(set.pointers, count, 0);
+  double ns = 0;
+  size_t merged = 0;
+  unsigned long usLast = 0;
+  for (int r = 0; r < rounds; r++)
+  {
+    unsigned long usRound = 100 + r * US_ROUND;
+    set.turn(usRound);
+    MergedRotaryEvent event;
+    size_t n = 0;
+    auto start = std::chrono::steady_clock::now();
+    if (byHeap)
+      while (merger.next(event, usRound + US_ROUND)) { n++; usLast = event.us; }
+    else
+      while (nextByScan(set, event)) { n++; usLast = event.us; }
+    ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    TEST_ASSERT_EQUAL(count * STEPS_PER_ROUND, n);
+    TEST_ASSERT_LESS_THAN(usRound + US_ROUND, usLast);
+    merged += n;
+  }
+  return ns / merged;
+}
+
+void test_merged_in_order(void)
+{
+  for (uint8_t count : {8, 64})
+  {
+    Encoders set(count);
+    RotaryEventMerger merger(set.pointers, count, 0);
+    unsigned long usPrev = 0;
+    uint32_t steps[RotaryEventMerger::MAX_ENCODERS] = {0};
+    for (int r = 0; r < 10; r++)
+    {
+      set.turn(100 + r * US_ROUND);
+      MergedRotaryEvent event;
+      while (merger.next(event, 100 + (r + 1) * US_ROUND))
+      {
+        TEST_ASSERT_TRUE(event.us >= usPrev);
+        TEST_ASSERT_EQUAL(ROTARY_CW, event.type);
+        usPrev = event.us;
+        steps[event.encoder]++;
+      }
+    }
+    for (uint8_t e = 0; e < count; e++) TEST_ASSERT_EQUAL(10 * STEPS_PER_ROUND, steps[e]);
+  }
+}
+
+/**
+ * Buffers emptied by someone else while in the heap are skipped, a buffer
+ * refilled meanwhile is sorted in by its new oldest event
+ */
+void test_emptied_buffer_skipped(void)
+{
+  Encoders set(3);
+  RotaryEventMerger merger(set.pointers, 3, 0);
+  set.turn(100);
+  MergedRotaryEvent event;
+  TEST_ASSERT_FALSE(merger.next(event, 100));    // all heads collected, none old enough
+  set.encoders[0].enableEventBuffer();           // emptied
+  set.encoders[1].enableEventBuffer();           // emptied and refilled later
+  unsigned long us = 100 + 2 * US_ROUND;
+  for (uint8_t ab : CW) set.encoders[1].feed(ab >> 1, ab & 1, HIGH, us++);
+
+  int count[3] = {0};
+  unsigned long usPrev = 0;
+  while (merger.next(event, us))
+  {
+    TEST_ASSERT_TRUE(event.us >= usPrev);
+    TEST_ASSERT_EQUAL(ROTARY_CW, event.type);
+    usPrev = event.us;
+    count[event.encoder]++;
+  }
+  TEST_ASSERT_EQUAL(0, count[0]);
+  TEST_ASSERT_EQUAL(1, count[1]);
+  TEST_ASSERT_EQUAL(STEPS_PER_ROUND, count[2]);
+  TEST_ASSERT_EQUAL(us - 1, usPrev);
+}
+
+void test_benchmark_merge_throughput(void)
+{
+  TEST_MESSAGE("encoders  heap ns/event  M events/s   scan ns/event  M events/s");
+  for (uint8_t count : {8, 16, 32, 64})
+  {
+    double heap = 1e30, scan = 1e30;
+    for (int round = 0; round < 3; round++)    // best of 3
+    {
+      heap = std::min(heap, merge(count, 20000 / count, true));
+      scan = std::min(scan, merge(count, 20000 / count, false));
+    }
+    char message[96];
+    snprintf(message, sizeof(message), "%8u  %13.1f  %10.1f   %13.1f  %10.1f", count, heap, 1e3 / heap, scan, 1e3 / scan);
+    TEST_MESSAGE(message);
+  }
+}
+
+int main(int, char **)
+{
+  rngState = 3;
+  UNITY_BEGIN();
+  RUN_TEST(test_merged_in_order);
+  RUN_TEST(test_emptied_buffer_skipped);
+  RUN_TEST(test_benchmark_merge_throughput);
+  return UNITY_END();
+}
@@ -0,0 +1,171 @@
+/**
+ * Test         test_pipeline
+ *
+ * Purpose      The composed pipelines decode exactly like the RotaryEncoder class
+ *              (both run the decoders of RotaryDecoders.h), acceleration on the fed
+ *              timestamps, and a benchmark of the default pipeline against a
+ *              hand-written loop of the table decoder and against the class fed
+ *              with the same samples.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include "RotaryPipeline.h"
+#include "RotaryEncoder.h"
+#include "../RotaryTestHelpers.h"
+
+typedef RotaryPipeline<FedSource, NoFilter, TableDecoder, NoPost, CounterSink> TablePipeline;
+typedef RotaryPipeline<FedSource, NoFilter, CleaningDecoder, NoPost, CounterSink> CleaningPipeline;
+typedef RotaryPipeline<FedSource, NoFilter, TableDecoder, AccelerationPost<5000, 10>, CounterSink> AcceleratedPipeline;
+
+
+/**
+ * Samples of a random motion with bouncing edges and occasional glitches
+ */
+static std::vector<uint8_t> motion(size_t steps, int bouncePercent)
+{
+  std::vector<uint8_t> samples(8, 0b11);
+  int quarter = 3;
+  for (size_t s = 0; s < steps; s++)
+  {
+    int dir = rng(4) == 0 ? -1 : 1;
+    for (int q = 0; q < 4; q++)
+    {
+      int prev = quarter;
+      quarter = (quarter + dir + 4) & 3;
+      while ((int)rng(100) < bouncePercent)
+      {
+        samples.push_back(CW[quarter]);
+        samples.push_back(CW[prev]);
+      }
+      if (rng(100) == 0) samples.push_back(CW[quarter] ^ 0b11);  // glitch on both lines
+      for (uint32_t n = 1 + rng(4); n > 0; n--) samples.push_back(CW[quarter]);
+    }
+  }
+  return samples;
+}
+
+template <class Pipeline>
+static long runPipeline(const std::vector<uint8_t> &samples)
+{
+  Pipeline pipeline;
+  pipeline.begin();
+  unsigned long us = 0;
+  for (uint8_t ab : samples)
+  {
+    pipeline.source.setBits(ab, us += 10);
+    pipeline.loop();
+  }
+  return pipeline.sink.getPosition();
+}
+
+/**
+ * The table decoder written out in one loop, as reference for the pipeline
+ */
+static long runHandWritten(const std::vector<uint8_t> &samples)
+{
+  uint8_t newTransition = 0, transitions = 0;
+  long position = 0;
+  for (uint8_t ab : samples)
+  {
+    newTransition = ((newTransition << 2) | ab) & 0b1111;
+    if ((ROTARY_VALID_TRANSITIONS >> newTransition) & 1)
+    {
+      transitions = (transitions << 4) | newTransition;
+      if (transitions == 0b00010111) position++;
+      else if (transitions == 0b00101011) position--;
+    }
+  }
+  return position;
+}
+
+static long runClass(const std::vector<uint8_t> &samples, bool byTable)
+{
+  RotaryEncoder encoder;
+  RotaryEncoderConfig config;
+  config.debouncingByTable = byTable;
+  config.usButtonInterval = 0;
+  encoder.publishConfig(config);
+  unsigned long us = 0;
+  for (uint8_t ab : samples) encoder.feed(ab >> 1, ab & 1, HIGH, us += 10);
+  return encoder.getPosition();
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_same_steps_as_class(void)
+{
+  for (int bounce = 0; bounce <= 40; bounce += 20)
+  {
+    std::vector<uint8_t> samples = motion(20000, bounce);
+    TEST_ASSERT_EQUAL(runClass(samples, true), runPipeline<TablePipeline>(samples));
+    TEST_ASSERT_EQUAL(runClass(samples, false), runPipeline<CleaningPipeline>(samples));
+    TEST_ASSERT_EQUAL(runHandWritten(samples), runPipeline<TablePipeline>(samples));
+  }
+}
+
+/**
+ * Steps less than 5 ms apart count 10 times, timed by the fed timestamps
+ * (far from the host clock) and not by micros()
+ */
+void test_acceleration_on_fed_time(void)
+{
+  AcceleratedPipeline pipeline;
+  pipeline.begin();
+  unsigned long us = 1000000000;
+  for (int s = 0; s < 4; s++)
+  {
+    us += s < 2 ? 20000 : 1000;       // 2 slow steps, then 2 fast ones
+    for (uint8_t ab : CW)
+    {
+      pipeline.source.setBits(ab, us);
+      pipeline.loop();
+    }
+  }
+  TEST_ASSERT_EQUAL(1 + 1 + 10 + 10, pipeline.sink.getPosition());
+}
+
+/**
+ * Cost per sample of the default pipeline, of the hand-written loop and of
+ * RotaryEncoder::feed() with the button sampled at the default interval
+ */
+void test_benchmark_pipeline_vs_class(void)
+{
+  std::vector<uint8_t> samples = motion(200000, 20);
+  volatile long sink = 0;
+  double nsPipeline = 1e30, nsHand = 1e30, nsClass = 1e30;
+  for (int round = 0; round < 5; round++)    // best of 5
+  {
+    auto start = std::chrono::steady_clock::now();
+    sink = sink + runPipeline<TablePipeline>(samples);
+    auto hand = std::chrono::steady_clock::now();
+    sink = sink + runHandWritten(samples);
+    auto middle = std::chrono::steady_clock::now();
+    RotaryEncoder encoder;
+    unsigned long us = 0;
+    for (uint8_t ab : samples) encoder.feed(ab >> 1, ab & 1, HIGH, us += 10);
+    sink = sink + encoder.getPosition();
+    auto end = std::chrono::steady_clock::now();
+    double p = std::chrono::duration<double, std::nano>(hand - start).count() / samples.size();
+    double h = std::chrono::duration<double, std::nano>(middle - hand).count() / samples.size();
+    double c = std::chrono::duration<double, std::nano>(end - middle).count() / samples.size();
+    if (p < nsPipeline) nsPipeline = p;
+    if (h < nsHand) nsHand = h;
+    if (c < nsClass) nsClass = c;
+  }
+  char message[128];
+  snprintf(message, sizeof(message), "%zu samples: pipeline %.2f ns/sample, hand-written %.2f ns/sample, class feed() %.2f ns/sample",
+           samples.size(), nsPipeline, nsHand, nsClass);
+  TEST_MESSAGE(message);
+}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_same_steps_as_class);
+  RUN_TEST(test_acceleration_on_fed_time);
+  RUN_TEST(test_benchmark_pipeline_vs_class);
+  return UNITY_END();
+}
@@ -0,0 +1,145 @@
+/**
+ * Test         test_prediction
+ *
+ * Purpose      Position prediction on synthesized motion profiles (constant speed,
+ *              acceleration, reversals, stop and go): the error of predictPosition()
+ *              and of the measured position against the true position, read like a
+ *              display once per millisecond, and the cost of the filter per sample
+ *              and per prediction.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include "RotaryEncoder.h"
+#include "../RotaryTestHelpers.h"
+
+static const unsigned long US_SAMPLE = 50;
+static const unsigned long US_FRAME  = 1000;
+static const unsigned long SECONDS   = 4;
+
+struct Profile
+{
+  const char *name;
+  double (*steps)(double s);    // true position in steps at time s (seconds)
+};
+
+static double constant(double s)     { return 50 * s; }
+static double accelerating(double s) { return 5 * s + 25 * s * s; }          // 5 to 205 steps/s
+static double reversing(double s)    { return 10 * sin(2 * M_PI * 0.5 * s); }
+static double stopAndGo(double s)                                           // 100 steps/s half of the time
+{
+  double period = floor(s);
+  return 50 * period + 100 * fmin(s - period, 0.5);
+}
+
+static const Profile profiles[] = {
+  {"constant", constant}, {"accelerating", accelerating}, {"reversing", reversing}, {"stop and go", stopAndGo}};
+
+/**
+ * CLK DT of the true position: the quarter floor(4 * steps), 11 at the detents
+ */
+static uint8_t levels(double steps)
+{
+  long quarter = (long)floor(4 * steps);
+  return CW[(quarter - 1) & 3];
+}
+
+struct Error
+{
+  double rmsPredicted, rmsMeasured;
+};
+
+static Error evaluate(const Profile &profile)
+{
+  RotaryEncoder encoder;
+  encoder.setSamplingIntervals(0, 0);
+  encoder.enablePrediction();
+  double sumPredicted = 0, sumMeasured = 0;
+  size_t frames = 0;
+  for (unsigned long us = US_SAMPLE; us <= SECONDS * 1000000; us += US_SAMPLE)
+  {
+    double steps = profile.steps(us / 1e6);
+    uint8_t ab = levels(steps);
+    encoder.feed(ab >> 1, ab & 1, HIGH, us);
+    if (us % US_FRAME) continue;
+
+    long measured = encoder.getPosition();
+    long predicted = encoder.predictPosition(us);
+    TEST_ASSERT_INT_WITHIN(255, measured * 256, predicted);   // never a step ahead of the encoder
+    double ePredicted = predicted / 256.0 - steps, eMeasured = measured - steps;
+    sumPredicted += ePredicted * ePredicted;
+    sumMeasured += eMeasured * eMeasured;
+    frames++;
+  }
+  return {sqrt(sumPredicted / frames), sqrt(sumMeasured / frames)};
+}
+
+/**
+ * ns per feed() of the samples of a profile
+ */
+static double feedCost(const std::vector<uint8_t> &samples, bool prediction)
+{
+  double best = 1e30;
+  for (int round = 0; round < 5; round++)    // best of 5
+  {
+    RotaryEncoder encoder;
+    encoder.setSamplingIntervals(0, 0);
+    encoder.enablePrediction(prediction);
+    unsigned long us = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint8_t ab : samples) encoder.feed(ab >> 1, ab & 1, HIGH, us += US_SAMPLE);
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    if (ns < best) best = ns;
+  }
+  return best / samples.size();
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_prediction_error(void)
+{
+  TEST_MESSAGE("profile        rms error predicted  measured  (steps, read every 1 ms)");
+  for (const Profile &profile : profiles)
+  {
+    Error error = evaluate(profile);
+    TEST_ASSERT_TRUE(error.rmsPredicted < error.rmsMeasured);
+    char message[96];
+    snprintf(message, sizeof(message), "%-13s  %19.3f  %8.3f", profile.name, error.rmsPredicted, error.rmsMeasured);
+    TEST_MESSAGE(message);
+  }
+}
+
+void test_benchmark_prediction_cost(void)
+{
+  std::vector<uint8_t> samples;
+  for (unsigned long us = US_SAMPLE; us <= SECONDS * 1000000; us += US_SAMPLE)
+    samples.push_back(levels(accelerating(us / 1e6)));
+  double nsOff = feedCost(samples, false), nsOn = feedCost(samples, true);
+
+  RotaryEncoder encoder;
+  encoder.setSamplingIntervals(0, 0);
+  encoder.enablePrediction();
+  unsigned long us = 0;
+  for (size_t i = 0; i < samples.size() / 2; i++) encoder.feed(samples[i] >> 1, samples[i] & 1, HIGH, us += US_SAMPLE);
+  volatile long sink = 0;
+  const int calls = 1000000;
+  auto start = std::chrono::steady_clock::now();
+  for (int n = 0; n < calls; n++) sink = sink + encoder.predictPosition(us + (n & 1023));
+  double nsPredict = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+
+  char message[128];
+  snprintf(message, sizeof(message), "feed() %.2f ns/sample without, %.2f ns/sample with prediction; predictPosition() %.2f ns",
+           nsOff, nsOn, nsPredict);
+  TEST_MESSAGE(message);
+}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_prediction_error);
+  RUN_TEST(test_benchmark_prediction_cost);
+  return UNITY_END();
+}
@@ -0,0 +1,118 @@
+/**
+ * Test         test_quadrature
+ *
+ * Purpose      Quadrature analysis of the table decoder on synthetic steps with
+ *              given dwell times of the 4 states: duty cycles and phase error,
+ *              asymmetric steps against the measured sampling interval.
+ */
+#include <unity.h>
+#include "RotaryEncoder.h"
+#include "../RotaryTestHelpers.h"
+
+
+void setUp(void) {}
+void tearDown(void) {}
+
+/**
+ * Feed steps CW with dwell times d[] (us) of 11, 10, 00, 01, polled every usPoll.
+ * The timestamps start far from micros(), as when fed from recorded samples.
+ */
+static const QuadratureStats &turn(RotaryEncoder &encoder, const unsigned long d[4], unsigned long usPoll, int steps)
+{
+  encoder.setSamplingIntervals(0, 0);
+  encoder.enableQuadratureAnalysis();
+  unsigned long us = 12345;
+  for (int s = 0; s < steps; s++)
+    for (int q = 0; q < 4; q++)
+      for (unsigned long u = 0; u < d[q]; u += usPoll) encoder.feed(QUARTER_LEVELS[q] >> 1, QUARTER_LEVELS[q] & 1, HIGH, us += usPoll);
+  encoder.feed(HIGH, HIGH, HIGH, us += usPoll);        // last step completes in the detent
+  TEST_ASSERT_EQUAL(steps, encoder.getPosition());
+  return encoder.getQuadratureStats();
+}
+
+void test_symmetric(void)
+{
+  RotaryEncoder encoder;
+  const unsigned long d[4] = {1000, 1000, 1000, 1000};
+  const QuadratureStats &stats = turn(encoder, d, 10, 100);
+  TEST_ASSERT_EQUAL(99, stats.steps);                   // 1st step: states before enabling unknown
+  TEST_ASSERT_EQUAL(128, stats.dutyClk);
+  TEST_ASSERT_EQUAL(128, stats.dutyData);
+  TEST_ASSERT_EQUAL(0, stats.phaseError);
+  TEST_ASSERT_EQUAL(64, stats.minState);
+  TEST_ASSERT_EQUAL(0, stats.asymmetricSteps);
+}
+
+void test_phase_error(void)
+{
+  RotaryEncoder encoder;
+  const unsigned long d[4] = {1500, 500, 1500, 500};    // DT follows CLK after 1/8 period
+  const QuadratureStats &stats = turn(encoder, d, 10, 100);
+  TEST_ASSERT_EQUAL(128, stats.dutyClk);
+  TEST_ASSERT_EQUAL(128, stats.dutyData);
+  TEST_ASSERT_EQUAL(-32, stats.phaseError);
+  TEST_ASSERT_EQUAL(32, stats.maxPhaseError);
+}
+
+void test_duty_cycle(void)
+{
+  RotaryEncoder encoder;
+  const unsigned long d[4] = {1200, 1200, 800, 800};    // CLK high 60 %
+  const QuadratureStats &stats = turn(encoder, d, 10, 100);
+  TEST_ASSERT_INT_WITHIN(1, 154, stats.dutyClk);
+  TEST_ASSERT_EQUAL(128, stats.dutyData);
+  TEST_ASSERT_INT_WITHIN(1, 0, stats.phaseError);
+}
+
+/**
+ * A state lasting a single sample is flagged at the measured sampling interval,
+ * one lasting 2 samples is not
+ */
+static void checkAsymmetric(unsigned long usPoll)
+{
+  RotaryEncoder single, twice;
+  const unsigned long d1[4] = {40 * usPoll, 40 * usPoll, 40 * usPoll, usPoll};
+  const unsigned long d2[4] = {40 * usPoll, 40 * usPoll, 40 * usPoll, 2 * usPoll};
+  TEST_ASSERT_EQUAL(99, turn(single, d1, usPoll, 100).asymmetricSteps);
+  TEST_ASSERT_EQUAL(0, turn(twice, d2, usPoll, 100).asymmetricSteps);
+}
+
+void test_asymmetric_5us(void)
+{
+  checkAsymmetric(5);
+}
+
+void test_asymmetric_10us(void)
+{
+  checkAsymmetric(10);
+}
+
+/**
+ * A bounce back into the detent in the middle of a step leaves the state times
+ * out of order, such a step is not analyzed
+ */
+void test_states_out_of_order(void)
+{
+  RotaryEncoder encoder;
+  const unsigned long d[4] = {1000, 1000, 1000, 1000};
+  turn(encoder, d, 10, 10);
+  uint32_t steps = encoder.getQuadratureStats().steps;
+  unsigned long us = 1000000;
+  static const uint8_t bounced[][2] = {{1, 0}, {1, 1}, {0, 1}, {0, 0}, {0, 1}, {1, 1}};
+  for (const uint8_t *levels : bounced)
+    for (int n = 0; n < 100; n++) encoder.feed(levels[0], levels[1], HIGH, us += 10);
+  TEST_ASSERT_EQUAL(11, encoder.getPosition());
+  TEST_ASSERT_EQUAL(steps, encoder.getQuadratureStats().steps);
+}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_symmetric);
+  RUN_TEST(test_phase_error);
+  RUN_TEST(test_duty_cycle);
+  RUN_TEST(test_asymmetric_5us);
+  RUN_TEST(test_asymmetric_10us);
+  RUN_TEST(test_states_out_of_order);
+  return UNITY_END();
+}
@@ -0,0 +1,126 @@
+/**
+ * Test         test_sampling
+ *
+ * Purpose      Separate sampling intervals of rotary pins and pushbutton: the same
+ *              recorded input polled every 10 us is decoded with the button sampled
+ *              in every pass and at the default 1 ms interval. The steps must be the
+ *              same, the button events the same within the bounce burst plus 1 ms,
+ *              and the cost per pass is reported.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include "RotaryEncoder.h"
+#include "../RotaryTestHelpers.h"
+
+static const unsigned long US_POLL = 10;
+
+/**
+ * Levels per pass, bits CLK DT SW = 2 1 0: turns at 5 to 500 steps/s with
+ * bouncing contacts and bouncing presses of 20 to 700 ms
+ */
+static std::vector<uint8_t> recording(unsigned long seconds)
+{
+  std::vector<uint8_t> passes;
+  size_t total = seconds * 1000000 / US_POLL;
+  int quarter = 3;
+  uint8_t sw = 1;
+  auto hold = [&](unsigned long us, uint8_t ab) { for (unsigned long t = 0; t < us; t += US_POLL) passes.push_back(ab << 1 | sw); };
+  while (passes.size() < total)
+  {
+    if (rng(2))
+    {
+      int dir = rng(2) ? 1 : -1;
+      unsigned long usQuarter = 500 + rng(50000);
+      for (uint32_t s = 1 + rng(20); s > 0; s--)
+        for (int q = 0; q < 4; q++)
+        {
+          int prev = quarter;
+          quarter = (quarter + dir + 4) & 3;
+          for (uint32_t b = rng(3); b > 0; b--) { hold(20, CW[quarter]); hold(20, CW[prev]); }
+          hold(usQuarter, CW[quarter]);
+        }
+    }
+    else
+    {
+      for (int edge = 0; edge < 2; edge++)
+      {
+        for (uint32_t b = rng(4); b > 0; b--) { sw ^= 1; hold(100 + rng(800), CW[quarter]); sw ^= 1; hold(100 + rng(800), CW[quarter]); }
+        sw ^= 1;
+        hold(edge == 0 ? 20000 + rng(700000) : 0, CW[quarter]);
+      }
+    }
+    hold(rng(600000), CW[quarter]);
+  }
+  return passes;
+}
+
+struct Decoded
+{
+  std::vector<RotaryEvent> events;
+  double nsPerPass;
+};
+
+static Decoded decode(const std::vector<uint8_t> &passes, unsigned long usButtonInterval)
+{
+  static std::vector<RotaryEvent> *events;
+  Decoded decoded;
+  events = &decoded.events;
+  RotaryEncoder encoder;
+  encoder.setSamplingIntervals(0, usButtonInterval);
+  encoder.addOnEventsCB([](const RotaryEvent *batch, uint8_t count) { events->insert(events->end(), batch, batch + count); });
+  unsigned long us = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint8_t levels : passes) encoder.feed(levels >> 2, (levels >> 1) & 1, levels & 1, us += US_POLL);
+  decoded.nsPerPass = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / passes.size();
+  return decoded;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_equal_accuracy_and_saving(void)
+{
+  std::vector<uint8_t> passes = recording(60);
+  Decoded every = decode(passes, 0);
+  Decoded slotted = decode(passes, 1000);
+  for (int round = 0; round < 2; round++)       // best of 3
+  {
+    every.nsPerPass = std::min(every.nsPerPass, decode(passes, 0).nsPerPass);
+    slotted.nsPerPass = std::min(slotted.nsPerPass, decode(passes, 1000).nsPerPass);
+  }
+
+  TEST_ASSERT_EQUAL(every.events.size(), slotted.events.size());
+  size_t steps = 0, buttonEvents = 0;
+  for (size_t i = 0; i < every.events.size(); i++)
+  {
+    const RotaryEvent &a = every.events[i], &b = slotted.events[i];
+    TEST_ASSERT_EQUAL(a.type, b.type);
+    if (a.type <= ROTARY_PRESSED_CCW)
+    {
+      steps++;
+      TEST_ASSERT_EQUAL(a.us, b.us);
+    }
+    else
+    {
+      buttonEvents++;
+      TEST_ASSERT_UINT_WITHIN(6500, a.us, b.us);        // the bounce burst (up to 5.4 ms) and 1 interval
+    }
+  }
+  TEST_ASSERT_GREATER_THAN(200, steps);
+  TEST_ASSERT_GREATER_THAN(20, buttonEvents);
+
+  char message[160];
+  snprintf(message, sizeof(message), "%zu steps, %zu button events: button every pass %.2f ns/pass, every 1 ms %.2f ns/pass (%.0f %% saved)",
+           steps, buttonEvents, every.nsPerPass, slotted.nsPerPass, 100 * (1 - slotted.nsPerPass / every.nsPerPass));
+  TEST_MESSAGE(message);
+}
+
+int main(int, char **)
+{
+  rngState = 7;
+  UNITY_BEGIN();
+  RUN_TEST(test_equal_accuracy_and_saving);
+  return UNITY_END();
+}
@@ -0,0 +1,61 @@
+/**
+ * Test         test_selfbench
+ *
+ * Purpose      rotaryEncoderSelfBenchmark() on the host, printed through puts()
+ *              like Serial.println() on the target: all sequences of both methods
+ *              are reported, with the steps the sequences contain and positive
+ *              costs in ns.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "RotaryEncoderBenchmark.h"
+
+static std::vector<std::string> lines;
+
+static void printLine(const char *line)
+{
+  puts(line);
+  lines.push_back(line);
+}
+
+void setUp(void)
+{
+  lines.clear();
+}
+
+void tearDown(void) {}
+
+void test_self_benchmark(void)
+{
+  rotaryEncoderSelfBenchmark(printLine);
+  TEST_ASSERT_EQUAL(2 + 2 * 4, lines.size());
+  TEST_ASSERT_NOT_NULL(strstr(lines[0].c_str(), ", ns"));
+
+  static const char *methods[2] = {"table", "cleaning"};
+  static const char *sequences[4] = {"idle", "clean", "bouncy", "fast"};
+  static const long steps[4] = {0, 16384 / 16, 16384 / 32, 16384 / 4};   // samples per step of the sequences
+  for (int m = 0; m < 2; m++)
+    for (int s = 0; s < 4; s++)
+    {
+      char method[16], sequence[16], perStep[16];
+      long n;
+      double perSample, perLoop;
+      const char *line = lines[2 + m * 4 + s].c_str();
+      TEST_ASSERT_EQUAL(6, sscanf(line, "%15s %15s %ld %lf %15s %lf", method, sequence, &n, &perSample, perStep, &perLoop));
+      TEST_ASSERT_EQUAL_STRING(methods[m], method);
+      TEST_ASSERT_EQUAL_STRING(sequences[s], sequence);
+      TEST_ASSERT_EQUAL(steps[s], n);
+      TEST_ASSERT_TRUE(perSample > 0);
+      TEST_ASSERT_TRUE(perLoop > 0);
+    }
+}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_self_benchmark);
+  return UNITY_END();
+}
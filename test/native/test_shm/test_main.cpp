@@ -0,0 +1,222 @@
+/**
+ * Test         test_shm
+ *
+ * Purpose      Export through shared memory: a reader mapped while the publisher
+ *              restarts keeps its position, reads the new events without losses
+ *              and counts the restart, also after a publisher died while writing
+ *              the snapshot; a reader falling behind counts the lost
+ *              events; and a benchmark of the latency from publish() in one thread
+ *              to readEvents() in another.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "RotaryEncoderShm.h"
+#include "RotaryEncoderShmReader.h"
+#include "../RotaryTestHelpers.h"
+
+static const char *NAME = "/rotary_test_shm";
+
+static unsigned long us;
+
+static RotaryEncoder *newEncoder()
+{
+  RotaryEncoder *encoder = new RotaryEncoder;
+  encoder->setSamplingIntervals(0, 0);
+  encoder->enableEventBuffer();
+  encoder->feed(HIGH, HIGH, HIGH, us += 100);
+  return encoder;
+}
+
+static void turn(RotaryEncoder &encoder, int steps)
+{
+  for (int s = 0; s < steps; s++)
+    for (uint8_t ab : CW) encoder.feed(ab >> 1, ab & 1, HIGH, us += 100);
+}
+
+void setUp(void)
+{
+  us = 0;
+  shm_unlink(NAME);
+}
+
+void tearDown(void)
+{
+  shm_unlink(NAME);
+}
+
+void test_restart_keeps_readers(void)
+{
+  RotaryEncoder *encoder = newEncoder();
+  RotaryEncoderShmPublisher publisher;
+  TEST_ASSERT_TRUE(publisher.begin(NAME));
+  RotaryEncoderShmReader reader;
+  TEST_ASSERT_TRUE(reader.begin(NAME));
+  turn(*encoder, 10);
+  publisher.publish(*encoder);
+  RotaryShmEvent events[ROTARY_SHM_RING_SIZE];
+  TEST_ASSERT_EQUAL(10, reader.readEvents(events, ROTARY_SHM_RING_SIZE));
+  turn(*encoder, 3);
+  publisher.publish(*encoder);                   // not read before the restart
+  delete encoder;
+
+  encoder = newEncoder();                        // restarted process
+  RotaryEncoderShmPublisher restarted;
+  TEST_ASSERT_TRUE(restarted.begin(NAME));
+  TEST_ASSERT_EQUAL(1, reader.getPublisherRestarts());
+  turn(*encoder, 5);
+  restarted.publish(*encoder);
+  TEST_ASSERT_EQUAL(8, reader.readEvents(events, ROTARY_SHM_RING_SIZE));
+  TEST_ASSERT_EQUAL(11, events[0].seq);
+  TEST_ASSERT_EQUAL(18, events[7].seq);
+  TEST_ASSERT_EQUAL(0, reader.getLostEvents());
+  RotaryShmSnapshot snapshot;
+  TEST_ASSERT_TRUE(reader.readSnapshot(snapshot));
+  TEST_ASSERT_EQUAL(5, snapshot.position);
+  TEST_ASSERT_EQUAL(18, snapshot.events);
+
+  RotaryEncoderShmReader late;                   // a new reader starts at the head
+  TEST_ASSERT_TRUE(late.begin(NAME));
+  TEST_ASSERT_EQUAL(0, late.readEvents(events, ROTARY_SHM_RING_SIZE));
+  TEST_ASSERT_EQUAL(0, late.getPublisherRestarts());
+  delete encoder;
+}
+
+/**
+ * The publisher dies between the odd and the even store of the snapshot seq,
+ * the restarted one must publish with the usual parity again
+ */
+void test_restart_after_torn_snapshot(void)
+{
+  RotaryEncoder *encoder = newEncoder();
+  {
+    RotaryEncoderShmPublisher publisher;
+    TEST_ASSERT_TRUE(publisher.begin(NAME));
+    publisher.publish(*encoder);
+  }
+  int fd = shm_open(NAME, O_RDWR, 0);
+  TEST_ASSERT_TRUE(fd >= 0);
+  RotaryShmRegion *region = (RotaryShmRegion *)mmap(nullptr, sizeof(RotaryShmRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  TEST_ASSERT_TRUE(region != MAP_FAILED);
+  region->snapshotSeq.fetch_add(1);              // odd, being written
+  region->snapshot.position = 12345;             // and never completed
+
+  RotaryEncoderShmReader reader;
+  TEST_ASSERT_TRUE(reader.begin(NAME));
+  RotaryShmSnapshot snapshot;
+  TEST_ASSERT_FALSE(reader.readSnapshot(snapshot));
+  RotaryEncoderShmPublisher restarted;
+  TEST_ASSERT_TRUE(restarted.begin(NAME));
+  TEST_ASSERT_EQUAL(0, region->snapshotSeq.load() & 1);
+  for (int n = 1; n <= 3; n++)
+  {
+    turn(*encoder, 1);
+    restarted.publish(*encoder);
+    TEST_ASSERT_EQUAL(0, region->snapshotSeq.load() & 1);
+    TEST_ASSERT_TRUE(reader.readSnapshot(snapshot));
+    TEST_ASSERT_EQUAL(n, snapshot.position);
+  }
+  munmap(region, sizeof(RotaryShmRegion));
+  delete encoder;
+}
+
+void test_lost_events_counted(void)
+{
+  RotaryEncoder *encoder = newEncoder();
+  RotaryEncoderShmPublisher publisher;
+  TEST_ASSERT_TRUE(publisher.begin(NAME));
+  RotaryEncoderShmReader reader;
+  TEST_ASSERT_TRUE(reader.begin(NAME));
+  for (int n = 0; n < 30; n++)                   // events fit the encoder's buffer per publish()
+  {
+    turn(*encoder, 10);
+    publisher.publish(*encoder);
+  }
+  RotaryShmEvent events[ROTARY_SHM_RING_SIZE];
+  TEST_ASSERT_EQUAL(ROTARY_SHM_RING_SIZE, reader.readEvents(events, ROTARY_SHM_RING_SIZE));
+  TEST_ASSERT_EQUAL(300 - ROTARY_SHM_RING_SIZE, reader.getLostEvents());
+  TEST_ASSERT_EQUAL(300, events[ROTARY_SHM_RING_SIZE - 1].seq);
+  delete encoder;
+}
+
+/**
+ * One step per publish() at stepsPerSecond; the reader polls in its own
+ * thread and takes the time each event is read
+ */
+static void measure(unsigned long stepsPerSecond, size_t steps)
+{
+  shm_unlink(NAME);                              // events numbered from 1
+  RotaryEncoder *encoder = newEncoder();
+  RotaryEncoderShmPublisher publisher;
+  TEST_ASSERT_TRUE(publisher.begin(NAME));
+  RotaryEncoderShmReader reader;
+  TEST_ASSERT_TRUE(reader.begin(NAME));
+
+  typedef std::chrono::steady_clock Clock;
+  std::vector<Clock::time_point> published(steps + 1), read(steps + 1);
+  std::atomic<bool> done(false);
+  std::thread consumer([&]() {
+    RotaryShmEvent events[ROTARY_SHM_RING_SIZE];
+    while (! done.load(std::memory_order_acquire))
+    {
+      size_t count = reader.readEvents(events, ROTARY_SHM_RING_SIZE);
+      if (count == 0) std::this_thread::yield();  // hosts with a single core run the publisher
+      Clock::time_point now = Clock::now();
+      for (size_t i = 0; i < count; i++)
+        if (events[i].seq <= steps) read[events[i].seq] = now;
+    }
+  });
+
+  auto nsPeriod = std::chrono::nanoseconds(1000000000ULL / stepsPerSecond);
+  Clock::time_point next = Clock::now();
+  for (size_t n = 1; n <= steps; n++)
+  {
+    std::this_thread::sleep_until(next);
+    turn(*encoder, 1);
+    published[n] = Clock::now();
+    publisher.publish(*encoder);
+    next += nsPeriod;
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  done.store(true, std::memory_order_release);
+  consumer.join();
+  TEST_ASSERT_EQUAL(0, reader.getLostEvents());
+
+  std::vector<double> latency;
+  for (size_t n = 1; n <= steps; n++)
+  {
+    TEST_ASSERT_TRUE(read[n] > published[n]);   // every event read
+    latency.push_back(std::chrono::duration<double, std::nano>(read[n] - published[n]).count());
+  }
+  std::sort(latency.begin(), latency.end());
+  char message[128];
+  snprintf(message, sizeof(message), "%6lu steps/s on %u cores: latency median %6.0f ns, 99 %% %7.0f ns, max %8.0f ns",
+           stepsPerSecond, std::thread::hardware_concurrency(), latency[steps / 2], latency[steps * 99 / 100], latency.back());
+  TEST_MESSAGE(message);
+  delete encoder;
+}
+
+void test_benchmark_latency(void)
+{
+  measure(1000, 2000);
+  measure(10000, 20000);
+  measure(100000, 50000);
+}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_restart_keeps_readers);
+  RUN_TEST(test_restart_after_torn_snapshot);
+  RUN_TEST(test_lost_events_counted);
+  RUN_TEST(test_benchmark_latency);
+  return UNITY_END();
+}
@@ -0,0 +1,153 @@
+/**
+ * Test         test_sim
+ *
+ * Purpose      RotaryEncoderSim::run() must give exactly the events of runDense()
+ *              (type and timestamp) for any poll period, start time and sampling
+ *              intervals, while feeding only a fraction of the passes.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <vector>
+#include "RotaryEncoderSim.h"
+#include "../RotaryTestHelpers.h"
+
+struct SimResult
+{
+  std::vector<RotaryEvent> events;
+  long position;
+  unsigned long feeds;
+};
+
+struct Scenario
+{
+  uint32_t seed;
+  unsigned long usPeriod, usStart, usRotary, usButton, usEnd;
+  bool chord, autoDebounce;
+};
+
+/**
+ * Random knob usage: turns, presses, bouncing presses, rotary glitches and pauses
+ */
+static void script(RotaryEncoderSim &sim, const Scenario &s)
+{
+  rngState = s.seed;
+  unsigned long us = s.usStart + rng(5000);
+  while (us < s.usEnd)
+  {
+    switch (rng(6))
+    {
+      case 0:
+      case 1:
+        us = sim.turn(us, (int)rng(7) - 3, 400 + rng(40000));
+        break;
+      case 2:
+        us = sim.press(us, 5000 + rng(400000));
+        break;
+      case 3:
+        for (int k = 0; k < 5; k++) sim.setLevels(us += 1 + rng(900), HIGH, HIGH, k & 1 ? HIGH : LOW);
+        us = sim.press(us + 1 + rng(100000), 1 + rng(3000));
+        break;
+      case 4:
+        sim.setLevels(us, 1, 0, HIGH);
+        sim.setLevels(us + 1 + rng(300), 1, 1, HIGH);
+        us += 1000;
+        break;
+      default:
+        us += rng(400000);
+        break;
+    }
+    us += 1 + rng(200000);
+  }
+}
+
+static SimResult simulate(const Scenario &s, bool dense)
+{
+  static std::vector<RotaryEvent> *events;
+  RotaryEncoder e;
+  SimResult result;
+  events = &result.events;
+  e.setSamplingIntervals(s.usRotary, s.usButton);
+  e.setChordMode(s.chord);
+  if (s.autoDebounce) e.enableAutoDebounce();
+  e.addOnEventsCB([](const RotaryEvent *batch, uint8_t count) { events->insert(events->end(), batch, batch + count); });
+
+  RotaryEncoderSim sim(e, s.usPeriod, s.usStart);
+  script(sim, s);
+  if (dense) sim.runDense(s.usEnd); else sim.run(s.usEnd);
+  result.position = e.getPosition();
+  result.feeds = sim.getFeeds();
+  return result;
+}
+
+static void checkEquivalent(const Scenario &s, unsigned long &feedsDense, unsigned long &feedsRun)
+{
+  SimResult dense = simulate(s, true);
+  SimResult run = simulate(s, false);
+  char message[160];
+  snprintf(message, sizeof(message), "seed %u period %lu start %lu intervals %lu %lu",
+           (unsigned)s.seed, s.usPeriod, s.usStart, s.usRotary, s.usButton);
+  TEST_ASSERT_EQUAL_MESSAGE(dense.position, run.position, message);
+  TEST_ASSERT_EQUAL_MESSAGE(dense.events.size(), run.events.size(), message);
+  for (size_t i = 0; i < dense.events.size(); i++)
+  {
+    TEST_ASSERT_EQUAL_MESSAGE(dense.events[i].us, run.events[i].us, message);
+    TEST_ASSERT_EQUAL_MESSAGE(dense.events[i].type, run.events[i].type, message);
+  }
+  feedsDense += dense.feeds;
+  feedsRun += run.feeds;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+/**
+ * First pass at usStart does not sample the rotary pins (interval 4, anchor 0):
+ * the first sample of the initial detent must still be taken at pass 11
+ */
+void test_first_pass_not_sampling(void)
+{
+  RotaryEncoder encoder;
+  encoder.setSamplingIntervals(4, 1000);
+  RotaryEncoderSim sim(encoder, 11, 0);
+  sim.setLevels(49408, 1, 0, 1);
+  sim.setLevels(49435, 1, 1, 1);
+  sim.run(60000);
+  TEST_ASSERT_EQUAL(0, encoder.getPosition());
+
+  unsigned long feedsDense = 0, feedsRun = 0;
+  Scenario s = {1, 11, 0, 4, 1000, 60000, false, false};
+  checkEquivalent(s, feedsDense, feedsRun);
+}
+
+void test_random_scenarios(void)
+{
+  static const unsigned long periods[]   = {1, 3, 7, 10, 11, 13, 50};
+  static const unsigned long intervals[] = {0, 4, 5, 250, 300, 997, 1000, 1001};
+  unsigned long feedsDense = 0, feedsRun = 0;
+  for (uint32_t n = 0; n < 320; n++)
+  {
+    rngState = 2463534242u + n * 7919u;
+    Scenario s;
+    s.usPeriod = periods[rng(7)];
+    s.usStart = rng(3) ? rng(100) : 0;
+    s.usRotary = intervals[rng(8)];
+    s.usButton = intervals[rng(8)];
+    s.usEnd = 1000000 + rng(2000000);
+    s.chord = rng(2);
+    s.autoDebounce = rng(2);
+    s.seed = 1 + n;
+    checkEquivalent(s, feedsDense, feedsRun);
+  }
+  char message[96];
+  snprintf(message, sizeof(message), "%lu passes fed instead of %lu", feedsRun, feedsDense);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_LESS_THAN(feedsDense / 10, feedsRun);
+}
+
+int main(int, char **)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_first_pass_not_sampling);
+  RUN_TEST(test_random_scenarios);
+  return UNITY_END();
+}
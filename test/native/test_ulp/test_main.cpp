@@ -0,0 +1,148 @@
+/**
+ * Test         test_ulp
+ *
+ * Purpose      The ULP program logic through ulpEncoderEmulate(): the same steps as
+ *              TableDecoder on bouncing and glitching samples, hand over of a step in
+ *              progress between RotaryEncoder and ULP and back, wake up by threshold
+ *              and button, and the sample rate limit: steps are decoded up to
+ *              1 / (4 * usPeriod) and lost beyond.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include <vector>
+#include "RotaryEncoderUlp.h"
+#include "../RotaryTestHelpers.h"
+
+static const uint16_t NEVER = 0x7fff;                     // threshold not reached in these tests
+
+static UlpEncoderState atDetent()
+{
+  UlpEncoderState state = {0b1111, 0, 0, 0};
+  return state;
+}
+
+static int16_t run(UlpEncoderState &state, uint8_t ab)
+{
+  ulpEncoderEmulate(state, ab >> 1, ab & 1, HIGH, NEVER);
+  return (int16_t)state.delta;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_same_steps_as_table_decoder(void)
+{
+  UlpEncoderState state = atDetent();
+  TableDecoder table;
+  table.setDetent();
+  long position = 0;
+  int quarter = 3;
+  for (int s = 0; s < 20000; s++)
+  {
+    int dir = rng(4) == 0 ? -1 : 1;
+    for (int q = 0; q < 4; q++)
+    {
+      int prev = quarter;
+      quarter = (quarter + dir + 4) & 3;
+      std::vector<uint8_t> samples;
+      for (uint32_t b = rng(3); b > 0; b--) { samples.push_back(CW[quarter]); samples.push_back(CW[prev]); }
+      if (rng(50) == 0) samples.push_back(CW[quarter] ^ 0b11);   // glitch on both lines
+      samples.push_back(CW[quarter]);
+      for (uint8_t ab : samples)
+      {
+        position += table.decode(ab);
+        TEST_ASSERT_EQUAL((int16_t)position, run(state, ab));
+      }
+    }
+  }
+  TEST_ASSERT_NOT_EQUAL(0, position);
+}
+
+/**
+ * Half a step by the encoder, the other half by the ULP during deep sleep,
+ * then back to the encoder: no step lost or added
+ */
+void test_handover_in_step(void)
+{
+  RotaryEncoder encoder;
+  encoder.setSamplingIntervals(0, 0);
+  unsigned long us = 0;
+  encoder.feed(HIGH, HIGH, HIGH, us += 100);
+  for (int q = 0; q < 6; q++) encoder.feed(CW[q & 3] >> 1, CW[q & 3] & 1, HIGH, us += 100);   // 1.5 steps
+  TEST_ASSERT_EQUAL(1, encoder.getPosition());
+
+  uint8_t newTransition;
+  uint16_t transitions;
+  encoder.getTableState(newTransition, transitions);
+  UlpEncoderState state = {newTransition, transitions, 0, 0};
+  for (int q = 6; q < 14; q++) run(state, CW[q & 3]);                                       // 2 steps
+  TEST_ASSERT_EQUAL(2, (int16_t)state.delta);
+
+  encoder.setTableState(state.newTransition, state.transitions);
+  for (int q = 14; q < 16; q++) encoder.feed(CW[q & 3] >> 1, CW[q & 3] & 1, HIGH, us += 100);
+  TEST_ASSERT_EQUAL(2, encoder.getPosition());                                              // + 2 by the ULP = 4 steps
+}
+
+void test_wake_up(void)
+{
+  UlpEncoderState state = atDetent();
+  int wakeups = 0;
+  for (int s = 0; s < 3; s++)
+    for (uint8_t ab : CW)
+      if (ulpEncoderEmulate(state, ab >> 1, ab & 1, HIGH, 3)) wakeups++;
+  TEST_ASSERT_EQUAL(1, wakeups);                 // at the 3rd step
+  TEST_ASSERT_EQUAL(0, state.button);
+
+  state = atDetent();
+  TEST_ASSERT_TRUE(ulpEncoderEmulate(state, HIGH, HIGH, LOW, NEVER));
+  TEST_ASSERT_EQUAL(1, state.button);
+}
+
+/**
+ * Fraction of the steps decoded when turning at stepsPerSecond with the ULP
+ * program run every usPeriod, at a random phase of the samples
+ */
+static double decoded(double stepsPerSecond, unsigned long usPeriod)
+{
+  const int steps = 2000;
+  double usQuarter = 1e6 / stepsPerSecond / 4;
+  UlpEncoderState state = atDetent();
+  double usSample = rng(usPeriod);
+  for (double usEnd = steps * 4 * usQuarter; usSample < usEnd; usSample += usPeriod)
+    run(state, CW[(long)(usSample / usQuarter) & 3]);
+  return (int16_t)state.delta / (double)steps;
+}
+
+void test_rate_limit(void)
+{
+  static const unsigned long periods[] = {100, 1000};
+  TEST_MESSAGE("usPeriod  limit steps/s  decoded at 0.5 / 0.9 / 1.0 / 1.2 / 2 x limit");
+  for (unsigned long usPeriod : periods)
+  {
+    double limit = 1e6 / (4.0 * usPeriod);
+    double at[5];
+    static const double factors[5] = {0.5, 0.9, 1.0, 1.2, 2.0};
+    for (int i = 0; i < 5; i++) at[i] = decoded(limit * factors[i], usPeriod);
+    TEST_ASSERT_EQUAL_FLOAT(1.0, at[0]);
+    TEST_ASSERT_EQUAL_FLOAT(1.0, at[1]);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 1.0, at[2]);
+    TEST_ASSERT_TRUE(at[3] < 0.9);                // states skipped, steps lost
+    TEST_ASSERT_TRUE(at[4] < 0.1);
+
+    char message[96];
+    snprintf(message, sizeof(message), "%8lu  %13.0f  %4.2f / %4.2f / %4.2f / %4.2f / %4.2f",
+             usPeriod, limit, at[0], at[1], at[2], at[3], at[4]);
+    TEST_MESSAGE(message);
+  }
+}
+
+int main(int, char **)
+{
+  rngState = 5;
+  UNITY_BEGIN();
+  RUN_TEST(test_same_steps_as_table_decoder);
+  RUN_TEST(test_handover_in_step);
+  RUN_TEST(test_wake_up);
+  RUN_TEST(test_rate_limit);
+  return UNITY_END();
+}